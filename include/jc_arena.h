@@ -0,0 +1,137 @@
+#ifndef _JCENGINE_ARENA_H_
+#define _JCENGINE_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include <jc_base.h>
+
+#define JC_ARENA_BLOCK_SIZE (64 * 1024)
+#define JC_ARENA_POISON 0xdd
+
+// Bump allocator for temporaries that die together: allocations are never
+// freed one by one, reset() drops all of them at once and keeps the memory.
+// If a cycle needed more than one block, they are merged into one on reset,
+// so a steady workload ends up bumping through a single block.
+// In DEBUG builds reset() fills the dropped bytes with JC_ARENA_POISON.
+// Not thread-safe, every thread wants its own arena.
+struct JCLinearArena {
+    struct _block {
+        char *data;
+        size_t size;
+    };
+
+    size_t block_size;
+    std::vector<_block> _blocks;
+    size_t _current;
+    size_t _offset;
+    size_t _used;           // bytes handed out since the last reset
+    size_t _peak;
+
+    _DELETE_COPY_MOVE_(JCLinearArena)
+
+    JCLinearArena(size_t block_size = JC_ARENA_BLOCK_SIZE);
+    ~JCLinearArena();
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        size_t p = (_offset + align - 1) & ~(align - 1);
+        if (_blocks.empty() || p + size > _blocks[_current].size) {
+            _grow(size + align);
+            p = (_offset + align - 1) & ~(align - 1);
+        }
+        _offset = p + size;
+        _used += size;
+        return _blocks[_current].data + p;
+    }
+
+    // Destructors are never run, so only trivially destructible types.
+    template<typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template<typename T>
+    T* makeArray(size_t n) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return new (allocate(sizeof(T) * n, alignof(T))) T[n];
+    }
+
+    void reset();
+    size_t used() const { return _used; }
+    size_t peak() const { return _peak > _used ? _peak : _used; }
+    size_t reserved() const;
+    void _grow(size_t at_least);
+};
+
+// Two linear arenas swapped by flip(), once per frame: memory taken during
+// frame N stays valid through frame N + 1 and is dropped by the flip after
+// that, so a frame can still read what the previous one built.
+struct JCFrameArena {
+    JCLinearArena _buffers[2];
+    int _current;
+    uint64_t frame_count;
+
+    _DELETE_COPY_MOVE_(JCFrameArena)
+
+    JCFrameArena(size_t block_size = JC_ARENA_BLOCK_SIZE)
+        : _buffers{{block_size}, {block_size}}, _current(0), frame_count(0) {}
+
+    JCLinearArena& current() { return _buffers[_current]; }
+    JCLinearArena& previous() { return _buffers[_current ^ 1]; }
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        return current().allocate(size, align);
+    }
+
+    template<typename T, typename... Args>
+    T* make(Args&&... args) {
+        return current().template make<T>(std::forward<Args>(args)...);
+    }
+
+    template<typename T>
+    T* makeArray(size_t n) {
+        return current().template makeArray<T>(n);
+    }
+
+    void flip() {
+        _current ^= 1;
+        current().reset();
+        frame_count += 1;
+    }
+};
+
+// Allocator adapter so standard containers can live in an arena:
+//   std::vector<int, JCArenaAllocator<int>> v{JCArenaAllocator<int>(arena)};
+// deallocate does nothing, growing a container leaves its old buffer behind
+// until the reset, so reserve() when the size is known.
+template<typename T>
+struct JCArenaAllocator {
+    using value_type = T;
+
+    JCLinearArena *arena;
+
+    JCArenaAllocator(JCLinearArena &arena) noexcept : arena(&arena) {}
+    JCArenaAllocator(JCFrameArena &frame) noexcept : arena(&frame.current()) {}
+    template<typename U>
+    JCArenaAllocator(const JCArenaAllocator<U> &other) noexcept : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *, size_t) noexcept {}
+
+    template<typename U>
+    bool operator==(const JCArenaAllocator<U> &other) const noexcept { return arena == other.arena; }
+    template<typename U>
+    bool operator!=(const JCArenaAllocator<U> &other) const noexcept { return arena != other.arena; }
+};
+
+template<typename T>
+using JCFrameVector = std::vector<T, JCArenaAllocator<T>>;
+
+#endif // _JCENGINE_ARENA_H_
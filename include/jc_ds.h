@@ -3,119 +3,387 @@
 
 #include <cstdint>
 #include <vector>
+#include <array>
+#include <string>
+#include <algorithm>
+#include <utility>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <new>
 
 #include <jc_base.h>
+#include <jc_pool.h>
 
 int _trie_name_ord(char s);
 char _trie_name_chr(int x);
-int countBits(int64_t x);
 
-template<typename T>
-struct JCIDAllocator {
-    std::vector<T> val;
-    std::vector<int> unused;
-    int idx = 0;
+// Every trie step ranks a child with it. One instruction when built with POPCNT
+// (JC_NATIVE_POPCNT or a -march that has it), a libgcc call otherwise.
+inline int countBits(uint64_t x) {
+    return __builtin_popcountll(x);
+}
 
-    T* get(int x) {
-        return &val[x];
-    }
+// Slot map handle: generation in the high 32 bits, slot index in the low 32 bits.
+// Generations start at 1, so a valid handle is never JC_SLOT_INVALID.
+using slot_id = uint64_t;
+#define JC_SLOT_INVALID 0
+
+// The handle half of a slot map, for owners keeping their own dense arrays
+// (e.g. several of them, structure of arrays): it maps handles to dense
+// indices and back. The owner appends an element and then calls insert();
+// erase() swap-removes like JCSlotMap and returns the index the owner moves
+// its last element into before popping it.
+struct JCSlotIndex {
+    struct _slot {
+        uint32_t dense;          // dense index, or the next free slot
+        uint32_t generation;
+    };
 
-    int create() {
-        if (unused.empty()) {
-            if (val.size() == idx) {
-                val.resize(val.size() * 2);
-                unused.resize(val.size());
-            }
-            return idx++;
-        } 
-        
-        int x = unused.back();
-        unused.pop_back();
-        return x;
+    std::vector<uint32_t> _owner;   // dense index -> slot
+    std::vector<_slot> _slots;
+    uint32_t _free = UINT32_MAX;
+
+    slot_id insert();
+    uint32_t erase(slot_id id);     // UINT32_MAX when id is stale
+    int contains(slot_id id) const {
+        uint32_t index = id & 0xffffffffu;
+        return index < _slots.size() && _slots[index].generation == (id >> 32);
+    }
+    uint32_t index(slot_id id) const {
+        return contains(id) ? _slots[id & 0xffffffffu].dense : UINT32_MAX;
+    }
+    slot_id handle(size_t dense) const {
+        uint32_t index = _owner[dense];
+        return (uint64_t)_slots[index].generation << 32 | index;
     }
+    size_t size() const { return _owner.size(); }
+};
+
+// Values are kept dense in `values` for iteration, handles stay valid until
+// their own erase and go stale after it, even when the slot is reused.
+// insert, erase and get are O(1); erase moves the last value into the hole,
+// so T* and iteration order are only stable until the next insert or erase.
+template<typename T>
+struct JCSlotMap {
+    std::vector<T> values;
+    JCSlotIndex _index;
 
-    int del(int x) {
-        unused.push_back(x);
-        return JC_SUCCESS;
+    slot_id insert(T x);
+    int erase(slot_id id);
+    T* get(slot_id id) {
+        uint32_t dense = _index.index(id);
+        return dense != UINT32_MAX ? &values[dense] : nullptr;
     }
+    int contains(slot_id id) const { return _index.contains(id); }
+    slot_id handle(size_t dense) const { return _index.handle(dense); }
+    size_t size() const { return values.size(); }
+    void clear();
+
+    typename std::vector<T>::iterator begin() { return values.begin(); }
+    typename std::vector<T>::iterator end() { return values.end(); }
 };
 
 template<typename T>
-struct JCTrieNode {
-    int64_t bitmask;
-    T x;
-    std::vector<JCTrieNode *> childs;
-    int hasChild(int x);
-    JCTrieNode* nextChild(int x);
+slot_id JCSlotMap<T>::insert(T x) {
+    slot_id id = _index.insert();
+    if (id != JC_SLOT_INVALID) values.push_back(std::move(x));
+    return id;
+}
 
-    _DELETE_COPY_MOVE_(JCTrieNode)
+template<typename T>
+int JCSlotMap<T>::erase(slot_id id) {
+    uint32_t dense = _index.erase(id);
+    if (dense == UINT32_MAX) return JC_ERROR;
+    if (dense != values.size() - 1) values[dense] = std::move(values.back());
+    values.pop_back();
+    return JC_SUCCESS;
+}
 
-    JCTrieNode() : bitmask(0) {}
+template<typename T>
+void JCSlotMap<T>::clear() {
+    while (!values.empty()) erase(handle(values.size() - 1));
+}
 
-    ~JCTrieNode() {
-        for (auto p : childs)
-            del_node(p);
-    }
+template<typename T>
+struct JCFrozenTrie;
 
-    static JCTrieNode<T>* new_node() {
-        return new JCTrieNode<T>();
-    }
+template<typename Trie, typename T>
+struct JCTrieCursor;
+
+// Nodes live in JCTrie::nodes and address their children by 32-bit index.
+// A node's children sit in one block of JCTrie::links, ordered by character,
+// so the one for character x is at `child + countBits(bitmask below x)`.
+template<typename T>
+struct JCTrieNode {
+    uint64_t bitmask;
+    uint32_t child;          // first slot of the child block in links
+    uint32_t capacity : 8;   // slots reserved at `child`, a power of two
+    uint32_t used : 1;       // a key ends here, set by create and cleared by erase
+    T x;
 
-    static int del_node(JCTrieNode<T>* ptr) {
-        delete ptr;
-        return JC_SUCCESS;
+    JCTrieNode() : bitmask(0), child(0), capacity(0), used(0), x() {}
+
+    int hasChild(int x) const {
+        return (bitmask >> x) & 1;
     }
 };
 
+// The whole trie is two vectors, root is nodes[0]. Index 0 is never a child,
+// so 0 doubles as "no child". links[0] is a zero sentinel that childless nodes
+// point at, so _child can always load. Returned T* stay valid until the next create.
+// get() also answers for inner nodes no key ends at, with a default T.
 template<typename T>
 struct JCTrie {
-    JCTrieNode<T> *root;
+    using cursor = JCTrieCursor<JCTrie, T>;
+
+    std::vector<JCTrieNode<T>> nodes;
+    std::vector<uint32_t> links;
+    std::array<std::vector<uint32_t>, 7> _free_links;   // released blocks, by log2 capacity
+    std::vector<uint32_t> _free_nodes;
+    std::vector<uint32_t> _path;
+
     T* get(const std::string &S);
     T* create(const std::string &S);
     int set(const std::string &S, T x);
+    int erase(const std::string &S);
+    // One pass: each key resumes from the common prefix with the previous
+    // one, so sorted input only ever walks the new suffix. Any order is correct.
+    int insert_sorted(const std::vector<std::pair<std::string, T>> &items);
+    cursor prefix(const std::string &S);
+    JCFrozenTrie<T> freeze() const;
+
+    uint32_t _find(const std::string &S) const;
+    uint32_t _child(uint32_t node, int x) const;
+    uint32_t _add_child(uint32_t node, int x);
+    void _remove_child(uint32_t node, int x);
+    uint32_t _alloc_links(int bits);
+    uint64_t _mask(uint32_t node) const { return nodes[node].bitmask; }
+    int _used(uint32_t node) const { return nodes[node].used; }
+    T& _value(uint32_t node) { return nodes[node].x; }
+
+    JCTrie() : nodes(1), links(1, 0) {}
+};
+
+// Immutable snapshot of a trie: a node's children are adjacent, so the child
+// for x is `first + countBits(bitmask below x)` with no link table.
+// Values may be written through get(), the shape never changes.
+template<typename T>
+struct JCFrozenTrie {
+    using cursor = JCTrieCursor<JCFrozenTrie, T>;
+
+    struct _node {
+        uint64_t bitmask;
+        uint32_t first;
+        uint32_t used;
+    };
+    std::vector<_node> nodes;
+    std::vector<T> values;
+
+    T* get(const std::string &S);
+    cursor prefix(const std::string &S);
+    static JCFrozenTrie merge(const JCFrozenTrie &base, const JCTrie<T> &delta);
+
+    uint32_t _find(const std::string &S) const;
+    uint32_t _child(uint32_t node, int x) const;
+    uint64_t _mask(uint32_t node) const { return nodes[node].bitmask; }
+    int _used(uint32_t node) const { return nodes[node].used; }
+    T& _value(uint32_t node) { return values[node]; }
+
+    JCFrozenTrie() : nodes{{0, 1, 0}}, values(1) {}
+};
+
+// Frozen trie plus a small mutable delta for keys added since the last merge.
+// A key lives in exactly one of them, so lookups try frozen then delta. The
+// delta is merged back once it outgrows `merge_nodes` or an eighth of frozen;
+// returned T* stay valid until the next create, as with JCTrie. Erased frozen
+// keys only lose their mark, the next merge rebuilds without them.
+template<typename T>
+struct JCSnapshotTrie {
+    JCFrozenTrie<T> frozen;
+    JCTrie<T> delta;
+    size_t merge_nodes = 256;
+    size_t _erased = 0;
+
+    T* get(const std::string &S);
+    T* create(const std::string &S);
+    int set(const std::string &S, T x);
+    int erase(const std::string &S);
+    // Merges first, then walks the frozen trie.
+    typename JCFrozenTrie<T>::cursor prefix(const std::string &S);
+    void merge();
+};
+
+// Trie for many reader threads and a few writers. Nodes are immutable once
+// published: a write copies the path from the root to its key and swaps the
+// root atomically, so readers never lock and always see a whole version.
+// Writers take `_write_mtx`. Replaced nodes are retired with the epoch they
+// were unlinked in and freed once no reader announced an epoch that old.
+template<typename T>
+struct JCConcurrentTrie {
+    struct _node {
+        uint64_t bitmask;
+        uint32_t used;
+        T x;
+        // countBits(bitmask) child pointers follow the node in the same allocation.
+        _node** children() { return reinterpret_cast<_node**>(this + 1); }
+    };
+
+    static constexpr int _reader_slots = 64;
+
+    std::atomic<_node*> _root;
+    std::atomic<uint64_t> _epoch;
+    std::array<std::atomic<uint64_t>, _reader_slots> _readers;   // 0 or the epoch a reader entered at
+    std::vector<std::pair<uint64_t, _node*>> _retired;
+    std::mutex _write_mtx;
 
-    JCTrie() {
-        root = JCTrieNode<T>::new_node();
+    _DELETE_COPY_MOVE_(JCConcurrentTrie)
+
+    JCConcurrentTrie();
+    ~JCConcurrentTrie();
+
+    // Copies the value out, the node may be freed once the read ends.
+    int get(const std::string &S, T *out);
+    int set(const std::string &S, T x);
+    int erase(const std::string &S);
+
+    int _enter();
+    void _leave(int slot);
+    // Nodes come from pools shared by all tries of this T, one per power of
+    // two child count, so each size class is a fixed-size block.
+    static int _size_class(uint64_t bitmask) {
+        int n = countBits(bitmask);
+        return n <= 1 ? n : 65 - __builtin_clzll(n - 1);
     }
+    static constexpr size_t _class_bytes(int cls) {
+        return sizeof(_node) + (cls == 0 ? 0 : 1u << (cls - 1)) * sizeof(_node*);
+    }
+    static JCBlockPool& _pool(int cls);
+    _node* _alloc(uint64_t bitmask);
+    void _free(_node *node);
+    void _free_tree(_node *node);
+    _node* _child(_node *node, int x) const;
+    _node* _copy(_node *node, int x, _node *child);
+    void _publish(_node *root, const std::vector<_node*> &replaced);
+};
+
+// Walks every key under a prefix depth first, in trie character order:
+//   for (auto c = trie.prefix("input."); c.next(); ) use(c.key(), c.value());
+// The key is built in one reused buffer, nothing is allocated per node.
+// Any create or erase on the trie invalidates the cursor.
+template<typename Trie, typename T>
+struct JCTrieCursor {
+    Trie *trie;
+    std::string _key;
+    std::vector<std::pair<uint32_t, uint64_t>> _stack;   // node, children left to visit
+    uint32_t _node;
+    int _started;
 
-    ~JCTrie() {
-        JCTrieNode<T>::del_node(root);
+    JCTrieCursor(Trie *t, const std::string &prefix) : trie(t), _key(prefix), _started(0) {
+        _node = trie->_find(prefix);
     }
+
+    bool next();
+    const std::string& key() const { return _key; }
+    T& value() { return trie->_value(_node); }
 };
 
 
 template<typename T>
-int JCTrieNode<T>::hasChild(int x) {
-    return (bitmask >> x) & 1;
+uint32_t JCTrie<T>::_child(uint32_t node, int x) const {
+    // Branchless: when x is absent read the block's first slot and mask it to 0.
+    const JCTrieNode<T> &n = nodes[node];
+    uint32_t has = -(uint32_t)((n.bitmask >> x) & 1);
+    uint32_t rank = countBits(n.bitmask & ((1ull << x) - 1));
+    return links[n.child + (rank & has)] & has;
 }
 
 template<typename T>
-JCTrieNode<T> * JCTrieNode<T>::nextChild(int x) {
-    int cnt = countBits(bitmask & ((1ll << x) - 1));
-    if (bitmask & (1ll << x))
-        return childs[cnt];
-    
-    bitmask ^= (1ll << x);
-    return *childs.insert(childs.begin() + cnt, JCTrieNode<T>::new_node());
+uint32_t JCTrie<T>::_alloc_links(int bits) {
+    auto &free = _free_links[bits];
+    if (!free.empty()) {
+        uint32_t block = free.back();
+        free.pop_back();
+        return block;
+    }
+    uint32_t block = links.size();
+    links.resize(links.size() + (1u << bits));
+    return block;
 }
 
 template<typename T>
-T* JCTrie<T>::get(const std::string &S) {
-    JCTrieNode<T> *ptr = root;
+uint32_t JCTrie<T>::_add_child(uint32_t node, int x) {
+    uint32_t index;
+    if (!_free_nodes.empty()) {
+        index = _free_nodes.back();
+        _free_nodes.pop_back();
+        nodes[index] = JCTrieNode<T>();
+    } else {
+        index = nodes.size();
+        nodes.emplace_back();
+    }
+    JCTrieNode<T> &n = nodes[node];
+
+    uint32_t count = countBits(n.bitmask);
+    if (count == n.capacity) {
+        // Full, move the block to one twice as large and free the old one.
+        int bits = n.capacity == 0 ? 0 : countBits(n.capacity - 1) + 1;
+        uint32_t block = _alloc_links(bits);
+        std::copy(links.begin() + n.child, links.begin() + n.child + count, links.begin() + block);
+        if (n.capacity) _free_links[bits - 1].push_back(n.child);
+        n.child = block;
+        n.capacity = 1u << bits;
+    }
+
+    uint32_t at = n.child + countBits(n.bitmask & ((1ull << x) - 1));
+    std::copy_backward(links.begin() + at, links.begin() + n.child + count,
+        links.begin() + n.child + count + 1);
+    links[at] = index;
+    n.bitmask |= 1ull << x;
+    return index;
+}
+
+template<typename T>
+void JCTrie<T>::_remove_child(uint32_t node, int x) {
+    JCTrieNode<T> &n = nodes[node];
+    uint32_t count = countBits(n.bitmask);
+    uint32_t at = n.child + countBits(n.bitmask & ((1ull << x) - 1));
+    std::copy(links.begin() + at + 1, links.begin() + n.child + count, links.begin() + at);
+    n.bitmask &= ~(1ull << x);
+    if (n.bitmask == 0) {
+        // Last child gone, hand the block back and point at the sentinel again.
+        _free_links[__builtin_ctz(n.capacity)].push_back(n.child);
+        n.child = 0;
+        n.capacity = 0;
+    }
+}
+
+template<typename T>
+uint32_t JCTrie<T>::_find(const std::string &S) const {
+    uint32_t node = 0;
     for (char c : S) {
-        int x = _trie_name_ord(c);
-        if (!ptr->hasChild(x)) return nullptr;
-        ptr = ptr->nextChild(x);
-    } return &ptr->x;
+        node = _child(node, _trie_name_ord(c));
+        if (node == 0) return UINT32_MAX;
+    } return node;
+}
+
+template<typename T>
+T* JCTrie<T>::get(const std::string &S) {
+    uint32_t node = _find(S);
+    return node == UINT32_MAX ? nullptr : &nodes[node].x;
 }
 
 template<typename T>
 T* JCTrie<T>::create(const std::string &S) {
-    JCTrieNode<T> *ptr = root;
+    uint32_t node = 0;
     for (char c : S) {
         int x = _trie_name_ord(c);
-        ptr = ptr->nextChild(x);
-    } return &ptr->x;
+        uint32_t next = _child(node, x);
+        node = next != 0 ? next : _add_child(node, x);
+    }
+    nodes[node].used = 1;
+    return &nodes[node].x;
 }
 
 template<typename T>
@@ -124,4 +392,378 @@ int JCTrie<T>::set(const std::string &S, T x) {
     return JC_SUCCESS;
 }
 
+template<typename T>
+int JCTrie<T>::erase(const std::string &S) {
+    _path.assign(1, 0);
+    for (char c : S) {
+        uint32_t node = _child(_path.back(), _trie_name_ord(c));
+        if (node == 0) return JC_ERROR;
+        _path.push_back(node);
+    }
+    JCTrieNode<T> &n = nodes[_path.back()];
+    if (!n.used) return JC_ERROR;
+    n.used = 0;
+    n.x = T();
+
+    // Reclaim the tail no other key needs, bottom up.
+    for (size_t depth = S.size(); depth > 0; --depth) {
+        uint32_t node = _path[depth];
+        if (nodes[node].used || nodes[node].bitmask) break;
+        _remove_child(_path[depth - 1], _trie_name_ord(S[depth - 1]));
+        _free_nodes.push_back(node);
+    }
+    return JC_SUCCESS;
+}
+
+template<typename T>
+int JCTrie<T>::insert_sorted(const std::vector<std::pair<std::string, T>> &items) {
+    // _path[i] is the node of the previous key's first i characters.
+    const std::string *prev = nullptr;
+    _path.assign(1, 0);
+    for (const auto &[key, value] : items) {
+        size_t common = 0;
+        if (prev != nullptr)
+            while (common < key.size() && common < prev->size() && key[common] == (*prev)[common]) ++common;
+        _path.resize(common + 1);
+        for (size_t i = common; i < key.size(); ++i) {
+            int x = _trie_name_ord(key[i]);
+            uint32_t next = _child(_path.back(), x);
+            _path.push_back(next != 0 ? next : _add_child(_path.back(), x));
+        }
+        nodes[_path.back()].used = 1;
+        nodes[_path.back()].x = value;
+        prev = &key;
+    }
+    return JC_SUCCESS;
+}
+
+template<typename T>
+typename JCTrie<T>::cursor JCTrie<T>::prefix(const std::string &S) {
+    return cursor(this, S);
+}
+
+template<typename T>
+JCFrozenTrie<T> JCTrie<T>::freeze() const {
+    return JCFrozenTrie<T>::merge(JCFrozenTrie<T>(), *this);
+}
+
+template<typename T>
+uint32_t JCFrozenTrie<T>::_child(uint32_t node, int x) const {
+    const _node &n = nodes[node];
+    uint32_t has = -(uint32_t)((n.bitmask >> x) & 1);
+    return (n.first + countBits(n.bitmask & ((1ull << x) - 1))) & has;
+}
+
+template<typename T>
+uint32_t JCFrozenTrie<T>::_find(const std::string &S) const {
+    uint32_t node = 0;
+    for (char c : S) {
+        node = _child(node, _trie_name_ord(c));
+        if (node == 0) return UINT32_MAX;
+    } return node;
+}
+
+template<typename T>
+T* JCFrozenTrie<T>::get(const std::string &S) {
+    uint32_t node = _find(S);
+    return node == UINT32_MAX ? nullptr : &values[node];
+}
+
+template<typename T>
+typename JCFrozenTrie<T>::cursor JCFrozenTrie<T>::prefix(const std::string &S) {
+    return cursor(this, S);
+}
+
+template<typename T>
+JCFrozenTrie<T> JCFrozenTrie<T>::merge(const JCFrozenTrie &base, const JCTrie<T> &delta) {
+    // Walk both tries depth first, in lockstep. A node's child block is laid
+    // out right before its subtree, so a chain of single children ends up
+    // contiguous the way a key's tail usually is.
+    constexpr uint32_t none = UINT32_MAX;
+    struct pending { uint32_t out, b, d; };
+    JCFrozenTrie out;
+    out.nodes.resize(1);
+    out.values.resize(1);
+    std::vector<pending> stack{{0, 0, 0}};
+    while (!stack.empty()) {
+        auto [o, b, d] = stack.back();
+        stack.pop_back();
+        uint64_t bmask = b != none ? base.nodes[b].bitmask : 0;
+        uint64_t dmask = d != none ? delta.nodes[d].bitmask : 0;
+        int bused = b != none && base.nodes[b].used, dused = d != none && delta.nodes[d].used;
+        uint32_t first = out.nodes.size(), count = countBits(bmask | dmask);
+        out.nodes[o] = {bmask | dmask, first, (uint32_t)(bused | dused)};
+        if (bused) out.values[o] = base.values[b];
+        else if (dused) out.values[o] = delta.nodes[d].x;
+        out.nodes.resize(first + count);
+        out.values.resize(first + count);
+        // Pushed last to first, so the first child is laid out next.
+        uint32_t i = count;
+        for (uint64_t m = bmask | dmask; m; ) {
+            int x = 63 - __builtin_clzll(m);
+            m ^= 1ull << x;
+            stack.push_back({first + --i, (bmask >> x) & 1 ? base._child(b, x) : none,
+                (dmask >> x) & 1 ? delta._child(d, x) : none});
+        }
+    }
+    return out;
+}
+
+template<typename T>
+T* JCSnapshotTrie<T>::get(const std::string &S) {
+    T *x = frozen.get(S);
+    return x != nullptr ? x : delta.get(S);
+}
+
+template<typename T>
+T* JCSnapshotTrie<T>::create(const std::string &S) {
+    uint32_t node = frozen._find(S);
+    if (node != UINT32_MAX) {
+        frozen.nodes[node].used = 1;
+        return &frozen.values[node];
+    }
+    T *x = delta.create(S);
+    if (delta.nodes.size() < std::max(merge_nodes, frozen.nodes.size() / 8)) return x;
+    merge();
+    return frozen.get(S);
+}
+
+template<typename T>
+int JCSnapshotTrie<T>::set(const std::string &S, T x) {
+    *create(S) = x;
+    return JC_SUCCESS;
+}
+
+template<typename T>
+int JCSnapshotTrie<T>::erase(const std::string &S) {
+    if (delta.erase(S) == JC_SUCCESS) return JC_SUCCESS;
+    uint32_t node = frozen._find(S);
+    if (node == UINT32_MAX || !frozen.nodes[node].used) return JC_ERROR;
+    frozen.nodes[node].used = 0;
+    frozen.values[node] = T();
+    _erased += 1;
+    return JC_SUCCESS;
+}
+
+template<typename T>
+typename JCFrozenTrie<T>::cursor JCSnapshotTrie<T>::prefix(const std::string &S) {
+    merge();
+    return frozen.prefix(S);
+}
+
+template<typename T>
+void JCSnapshotTrie<T>::merge() {
+    if (_erased) {
+        // Rebuild from the live keys, the cursor hands them over in order.
+        JCTrie<T> live;
+        for (auto c = frozen.prefix(""); c.next(); ) live.set(c.key(), c.value());
+        for (auto c = delta.prefix(""); c.next(); ) live.set(c.key(), c.value());
+        frozen = live.freeze();
+        delta = JCTrie<T>();
+        _erased = 0;
+        return;
+    }
+    if (delta.nodes.size() == 1 && !delta.nodes[0].used) return;
+    frozen = JCFrozenTrie<T>::merge(frozen, delta);
+    delta = JCTrie<T>();
+}
+
+template<typename T>
+JCConcurrentTrie<T>::JCConcurrentTrie() : _epoch(1) {
+    for (auto &slot : _readers) slot.store(0, std::memory_order_relaxed);
+    _root.store(_alloc(0));
+}
+
+template<typename T>
+JCConcurrentTrie<T>::~JCConcurrentTrie() {
+    _free_tree(_root.load());
+    for (auto &[epoch, node] : _retired) _free(node);
+}
+
+template<typename T>
+JCBlockPool& JCConcurrentTrie<T>::_pool(int cls) {
+    static JCBlockPool pools[8] = {
+        {"trie", _class_bytes(0)}, {"trie", _class_bytes(1)}, {"trie", _class_bytes(2)},
+        {"trie", _class_bytes(3)}, {"trie", _class_bytes(4)}, {"trie", _class_bytes(5)},
+        {"trie", _class_bytes(6), 64}, {"trie", _class_bytes(7), 16},
+    };
+    return pools[cls];
+}
+
+template<typename T>
+typename JCConcurrentTrie<T>::_node* JCConcurrentTrie<T>::_alloc(uint64_t bitmask) {
+    void *p = _pool(_size_class(bitmask)).allocate();
+    _node *node = new (p) _node{bitmask, 0, T()};
+    return node;
+}
+
+template<typename T>
+void JCConcurrentTrie<T>::_free(_node *node) {
+    int cls = _size_class(node->bitmask);
+    node->~_node();
+    _pool(cls).deallocate(node);
+}
+
+template<typename T>
+void JCConcurrentTrie<T>::_free_tree(_node *node) {
+    for (int i = 0, n = countBits(node->bitmask); i < n; ++i) _free_tree(node->children()[i]);
+    _free(node);
+}
+
+template<typename T>
+typename JCConcurrentTrie<T>::_node* JCConcurrentTrie<T>::_child(_node *node, int x) const {
+    if (!((node->bitmask >> x) & 1)) return nullptr;
+    return node->children()[countBits(node->bitmask & ((1ull << x) - 1))];
+}
+
+// Copy of `node` (nullptr: an empty one) with child x replaced by `child`,
+// or removed when `child` is nullptr. x < 0 copies the children as they are.
+template<typename T>
+typename JCConcurrentTrie<T>::_node* JCConcurrentTrie<T>::_copy(_node *node, int x, _node *child) {
+    uint64_t mask = node != nullptr ? node->bitmask : 0;
+    if (x >= 0) mask = child != nullptr ? mask | 1ull << x : mask & ~(1ull << x);
+    _node *copy = _alloc(mask);
+    if (node != nullptr) {
+        copy->used = node->used;
+        copy->x = node->x;
+    }
+    for (uint64_t m = mask; m; m &= m - 1) {
+        int c = __builtin_ctzll(m);
+        copy->children()[countBits(mask & ((1ull << c) - 1))] = c == x ? child : _child(node, c);
+    }
+    return copy;
+}
+
+template<typename T>
+int JCConcurrentTrie<T>::_enter() {
+    // Claim a free slot, starting from one that depends on the thread.
+    static thread_local int hint = std::hash<std::thread::id>()(std::this_thread::get_id()) % _reader_slots;
+    for (int i = hint, tries = 1; ; i = (i + 1) % _reader_slots, ++tries) {
+        uint64_t idle = 0;
+        if (_readers[i].compare_exchange_weak(idle, _epoch.load())) {
+            hint = i;
+            return i;
+        }
+        // Every slot busy, more readers than _reader_slots right now.
+        if (tries % _reader_slots == 0) std::this_thread::yield();
+    }
+}
+
+template<typename T>
+void JCConcurrentTrie<T>::_leave(int slot) {
+    _readers[slot].store(0, std::memory_order_release);
+}
+
+template<typename T>
+int JCConcurrentTrie<T>::get(const std::string &S, T *out) {
+    int slot = _enter();
+    _node *node = _root.load();
+    for (char c : S) {
+        node = _child(node, _trie_name_ord(c));
+        if (node == nullptr) break;
+    }
+    int ret = JC_ERROR;
+    if (node != nullptr && node->used) {
+        *out = node->x;
+        ret = JC_SUCCESS;
+    }
+    _leave(slot);
+    return ret;
+}
+
+template<typename T>
+int JCConcurrentTrie<T>::set(const std::string &S, T x) {
+    std::lock_guard<std::mutex> lock(_write_mtx);
+    // path[i] is the current node for the first i characters, nullptr past the trie.
+    std::vector<_node*> path{_root.load()};
+    for (char c : S) path.push_back(path.back() ? _child(path.back(), _trie_name_ord(c)) : nullptr);
+
+    _node *leaf = path.back();
+    _node *fresh = _copy(leaf, -1, nullptr);
+    fresh->used = 1;
+    fresh->x = x;
+    for (size_t depth = S.size(); depth > 0; --depth)
+        fresh = _copy(path[depth - 1], _trie_name_ord(S[depth - 1]), fresh);
+
+    path.erase(std::remove(path.begin(), path.end(), nullptr), path.end());
+    _publish(fresh, path);
+    return JC_SUCCESS;
+}
+
+template<typename T>
+int JCConcurrentTrie<T>::erase(const std::string &S) {
+    std::lock_guard<std::mutex> lock(_write_mtx);
+    std::vector<_node*> path{_root.load()};
+    for (char c : S) {
+        path.push_back(_child(path.back(), _trie_name_ord(c)));
+        if (path.back() == nullptr) return JC_ERROR;
+    }
+    _node *leaf = path.back();
+    if (!leaf->used) return JC_ERROR;
+
+    // Drop the leaf and every ancestor left without key or children.
+    size_t depth = S.size();
+    _node *fresh = nullptr;
+    if (leaf->bitmask != 0 || depth == 0) {
+        fresh = _copy(leaf, -1, nullptr);
+        fresh->used = 0;
+        fresh->x = T();
+    }
+    for (; depth > 0; --depth) {
+        _node *parent = path[depth - 1];
+        int x = _trie_name_ord(S[depth - 1]);
+        if (fresh == nullptr && depth > 1 && !parent->used && parent->bitmask == (1ull << x)) continue;
+        fresh = _copy(parent, x, fresh);
+    }
+    _publish(fresh, path);
+    return JC_SUCCESS;
+}
+
+template<typename T>
+void JCConcurrentTrie<T>::_publish(_node *root, const std::vector<_node*> &replaced) {
+    _root.store(root);
+    // Readers that enter from now on see `root`. Those that announced an
+    // epoch up to `unlinked` may still hold the replaced nodes.
+    uint64_t unlinked = _epoch.fetch_add(1);
+    for (_node *node : replaced) _retired.push_back({unlinked, node});
+
+    uint64_t oldest = UINT64_MAX;
+    for (auto &slot : _readers) {
+        uint64_t epoch = slot.load();
+        if (epoch != 0) oldest = std::min(oldest, epoch);
+    }
+    size_t kept = 0;
+    for (auto &[epoch, node] : _retired) {
+        if (epoch < oldest) _free(node);
+        else _retired[kept++] = {epoch, node};
+    }
+    _retired.resize(kept);
+}
+
+template<typename Trie, typename T>
+bool JCTrieCursor<Trie, T>::next() {
+    if (!_started) {
+        _started = 1;
+        if (_node == UINT32_MAX) return false;
+        _stack.push_back({_node, trie->_mask(_node)});
+        if (trie->_used(_node)) return true;
+    }
+    while (!_stack.empty()) {
+        auto &[node, left] = _stack.back();
+        if (left == 0) {
+            // The prefix frame has no character of its own to drop.
+            if (_stack.size() > 1) _key.pop_back();
+            _stack.pop_back();
+            continue;
+        }
+        int x = __builtin_ctzll(left);
+        left &= left - 1;
+        _node = trie->_child(node, x);
+        _key.push_back(_trie_name_chr(x));
+        _stack.push_back({_node, trie->_mask(_node)});
+        if (trie->_used(_node)) return true;
+    }
+    return false;
+}
+
 #endif // _JCENGINE_DS_H_
\ No newline at end of file
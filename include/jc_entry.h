@@ -3,6 +3,8 @@
 
 #include <jc_event.h>
 #include <jc_base.h>
+#include <jc_transform.h>
+#include <jc_sprite.h>
 #include <SDL3/SDL.h>
 #include <atomic>
 #include <mutex>
@@ -10,42 +12,59 @@
 
 
 #define DEFAULT_BUFFER_SIZE 4096
+#define DEFAULT_WHEEL_LEVELS 3
 #define DEFAULT_TIMER_TICK 5
 
 extern Uint32 JC_TIMER_EVENT;
 int JCEntryInit();
 
-struct JCEventTimerCallbackData {
-    cmd_type callback;
-    void* userdata;
-    
-    JCEventTimerCallbackData(cmd_type cb, void* ud) 
-        : callback(std::move(cb)), userdata(ud) {}
-};
-template<int buffer_size = DEFAULT_BUFFER_SIZE>
-struct JCEventTimerPacker : JCEventTimer<buffer_size> {
-    int createEvent(int timeout, int interval, cmd_type callback, void *userdata = nullptr) {
+// Timer whose callbacks run on the thread calling JCEntry::mainloop:
+// the timer thread only batches expired timers and posts them as JC_TIMER_EVENT.
+template<int buffer_size = DEFAULT_BUFFER_SIZE, int wheel_levels = DEFAULT_WHEEL_LEVELS>
+struct JCEventTimerPacker : JCEventTimer<buffer_size, wheel_levels> {
+    using batch_type = typename JCEventTimer<buffer_size, wheel_levels>::JCEventTimerBatch;
+
+    // Batches are made on the timer thread and freed by mainloop, every tick.
+    static JCObjectPool<batch_type>& batchPool() {
+        static JCObjectPool<batch_type> pool("timer", 64, 1);
+        return pool;
+    }
+
+    JCEventTimerPacker() {
+        this->executor = [](batch_type batch) {
+            SDL_Event ev;
+            ev.type = JC_TIMER_EVENT;
+            batch_type *pooled = batchPool().create(std::move(batch));
+            ev.user.data1 = pooled;
+            // Queue full: the callbacks must not run here, skip this expiry.
+            if (!SDL_PushEvent(&ev)) {
+                pooled->drop();
+                batchPool().destroy(pooled);
+            }
+        };
+    }
+
+    timer_id createEvent(int timeout, int interval, cmd_type callback, void *userdata = nullptr) {
         JCEntryInit();
-        auto data = std::make_shared<JCEventTimerCallbackData>(std::move(callback), userdata);
-    
-        return this->registerEvent(timeout, interval, 
-            [data](void *ptr) {  // shared_ptr 自动管理生命周期
-                jclog << "Pushing My event: " << JC_TIMER_EVENT << "\n";
-                SDL_Event ev;
-                ev.type = JC_TIMER_EVENT;
-                ev.user.data1 = data.get();
-                SDL_PushEvent(&ev);
-                return JC_SUCCESS;
-            });
+        return this->registerEvent(timeout, interval, std::move(callback), userdata);
     }
 };
 
 struct JCEntry {
     int _running;
+    event_id _quit_event;
 
-    JCTrie<void *> props;
+    JCConcurrentTrie<void *> props;     // shared across threads, reads never lock
+    JCWorkerPool workers;
     JCEventCenter ev;
-    JCEventTimerPacker<DEFAULT_BUFFER_SIZE> timer;
+    JCEventTimerPacker<DEFAULT_BUFFER_SIZE, DEFAULT_WHEEL_LEVELS> timer;
+    // Main thread temporaries, flipped before every refresh, so they live for
+    // this frame and the next one: dispatched posts and sprite vertices.
+    JCFrameArena frame;
+    // Moved by their velocities on every refresh, before the refresh handlers run.
+    JCTransforms transforms;
+    // Refresh handlers queue their sprites here, drawn after the last handler.
+    JCSpriteBatch sprites;
 
     SDL_Window *window;
     SDL_Renderer *render;
@@ -55,6 +74,7 @@ struct JCEntry {
 
     JCEntry(const std::string& name = "", int width = 1080, int height = 720,
         SDL_WindowFlags winflags = SDL_WINDOW_RESIZABLE);
+    ~JCEntry();
     int initGPU(SDL_GPUShaderFormat format = SDL_GPU_SHADERFORMAT_SPIRV);
     void start(int fps);
     void quit();
@@ -2,44 +2,231 @@
 #define _JCENGINE_SUBSYS_EVENT_H_
 
 #include <functional>
+#include <array>
 #include <vector>
 #include <cstdint>
 #include <string>
 #include <chrono>
 #include <queue>
+#include <deque>
+#include <unordered_map>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
 #include <cassert>
 #include <algorithm>
+#include <climits>
+#include <type_traits>
+#include <cstring>
 #include <numeric>
+#include <memory>
 
 #include <jc_base.h>
 #include <jc_ds.h>
+#include <jc_func.h>
+#include <jc_worker.h>
+#include <jc_pool.h>
+#include <jc_arena.h>
 
 using namespace std::chrono_literals;
 
-using cmd_type = std::function<int(void *)>;
+// Move-only, typical lambdas are stored in place without allocating.
+using cmd_type = JCInlineFunction<int(void *)>;
 using ms_timepoint = std::chrono::time_point<std::chrono::steady_clock>;
 
+// Timer handle: generation in the high 32 bits, pool index in the low 32 bits.
+// Generations start at 1, so a valid handle is never JC_TIMER_INVALID.
+using timer_id = uint64_t;
+#define JC_TIMER_INVALID 0
+
 int _event_name_ord(char s);
 
 char _event_name_chr(int x);
 
-int countBits(int64_t x);
+// Dense per-center index of an interned event name, 0 is never handed out.
+using event_id = uint32_t;
+#define JC_EVENT_INVALID 0
+
+constexpr bool _event_name_valid(char s) {
+    return ('a' <= s && s <= 'z') || ('A' <= s && s <= 'Z') || ('0' <= s && s <= '9')
+        || s == '_' || s == '.';
+}
+
+// FNV-1a over the name, validating it on the way. Evaluated at compile time
+// an invalid name is a compile error instead of a throw.
+constexpr uint64_t _event_name_hash(const char *s, size_t n) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < n; ++i) {
+        if (!_event_name_valid(s[i]))
+            throw std::string("Invalid Event Name, can only contain [A-Z][a-z][0-9]._");
+        hash = (hash ^ (unsigned char)s[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Name checked and hashed at compile time: constexpr auto refresh = "refresh"_event;
+// Every use of a key still looks it up in the center. It is a convenience for
+// cold paths; hot ones keep the event_id from intern(key) and emit by id.
+struct JCEventKey {
+    const char *name;
+    size_t size;
+    uint64_t hash;
+    constexpr JCEventKey(const char *s, size_t n) : name(s), size(n), hash(_event_name_hash(s, n)) {}
+};
+
+constexpr JCEventKey operator""_event(const char *s, size_t n) {
+    return JCEventKey(s, n);
+}
+
+// Payloads of posted events are copied by value into the queue.
+#define JC_EVENT_PAYLOAD_SIZE 24
+
+// Subscription handle: generation in the high 32 bits, index in the low 32 bits.
+using subscription_id = uint64_t;
+#define JC_SUBSCRIPTION_INVALID 0
+
+struct JCEventHandler {
+    cmd_type cmd;
+    int place;          // smaller runs first, -1 after every prioritized handler
+    uint32_t sub;       // index in JCEventCenter::_subs, UINT32_MAX once unsubscribed
+};
 
+// `cmds` stays sorted by place, so emit never sorts. Removed handlers are left
+// as tombstones and compacted away later, never while the event is emitting;
+// handlers registered during an emit wait in `_added` for the same reason.
 struct JCEventTrieNode {
-    std::vector<cmd_type> cmds;
-    int emit(void *userdata);
+    std::vector<JCEventHandler> cmds;
+    std::vector<JCEventHandler> _added;
+    uint32_t _dead = 0;                 // tombstones in cmds, not in _added
+    int _emitting = 0;
+    int coalesce = 0;                   // posts in one frame collapse, last payload wins
+    uint64_t _queued = UINT64_MAX;      // queue sequence of its pending post, for coalesce
+    int parallel = 0;                   // handlers are independent, fan out to the pool
+    int emit(void *userdata, JCWorkerPool *pool = nullptr);
+};
+
+struct JCSubscription {
+    event_id id;
+    uint32_t position;      // in cmds, or in _added while `added`
+    uint32_t generation = 1;
+    uint32_t _free_next = UINT32_MAX;
+    int added = 0;
+};
+
+// Process-wide index per payload type, handed out on first use, so it is
+// already valid when a static initializer in another file subscribes.
+inline uint32_t _next_type_index() {
+    static std::atomic<uint32_t> count{0};
+    return count.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<typename T>
+struct JCEventType {
+    static uint32_t index() {
+        static const uint32_t i = _next_type_index();
+        return i;
+    }
+};
+
+struct JCPostedEvent {
+    event_id id;
+    uint32_t size;
+    alignas(8) unsigned char payload[JC_EVENT_PAYLOAD_SIZE];
 };
 
+// Names are interned once into an event_id indexing the `events` table,
+// hot paths emit by id; the string overloads walk `trie` and stay for tooling.
+// `events` is a deque so a handler interning new events never moves the one emitting.
 struct JCEventCenter {
-    JCTrie<JCEventTrieNode> trie;
+    JCSnapshotTrie<event_id> trie;
+    std::deque<JCEventTrieNode> events;
+    std::vector<std::string> names;
+    std::unordered_map<uint64_t, event_id> _hashed;
+    std::vector<JCSubscription> _subs;
+    uint32_t _subs_free = UINT32_MAX;
+
+    // Events marked parallel run all their handlers on `pool` and join before
+    // emit returns. There is no chain: every handler runs, and the emit fails
+    // if any returned JC_ERROR. Their handlers must not touch the center.
+    JCWorkerPool *pool = nullptr;
+    int setParallel(event_id id, int parallel);
+
     JCEventCenter();
     ~JCEventCenter();
-    int registerEvent(const std::string &S, const cmd_type& cmd, int place = -1);
+    event_id intern(const std::string &S);
+    event_id intern(const JCEventKey &key);      // one hash probe, no trie walk
+    event_id find(const std::string &S);
+    subscription_id registerEvent(const std::string &S, cmd_type cmd, int place = -1);
+    subscription_id registerEvent(event_id id, cmd_type cmd, int place = -1);
+    int unsubscribe(subscription_id sub);
+    void _insert(JCEventTrieNode &event, JCEventHandler handler);
+    void _settle(JCEventTrieNode &event);
     int emitEvent(const std::string &S, void *userdata = nullptr);
+    int emitEvent(const JCEventKey &key, void *userdata = nullptr);    // intern(key) first, every call
+    int emitEvent(event_id id, void *userdata = nullptr);
     inline void checkNameValid(const std::string &S);
+
+    // Deferred events: post() appends to a ring buffer and dispatch(), called
+    // once per frame, runs them grouped by id with a pointer to the payload copy
+    // as userdata. Posts made while dispatching wait for the next dispatch.
+    // Like the rest of the center, only for the thread running the main loop.
+    // With `frame` set the dispatched copies are taken from it, so a payload
+    // pointer stays valid through the next frame; otherwise they go to _batch.
+    std::vector<JCPostedEvent> _ring;
+    std::vector<JCPostedEvent> _batch;
+    std::vector<uint64_t> _order;       // id << 32 | position in the batch
+    JCFrameArena *frame = nullptr;
+    uint64_t _ring_head, _ring_tail;
+    int _dispatching;
+
+    int setCoalesce(event_id id, int coalesce);
+    int post(event_id id) { return _post(id, nullptr, 0); }
+    template<typename T>
+    int post(event_id id, const T &payload) {
+        static_assert(std::is_trivially_copyable<T>::value, "posted payload must be trivially copyable");
+        static_assert(sizeof(T) <= JC_EVENT_PAYLOAD_SIZE && alignof(T) <= 8,
+            "posted payload larger than JC_EVENT_PAYLOAD_SIZE");
+        return _post(id, &payload, sizeof(T));
+    }
+    template<typename... T>
+    int post(const JCEventKey &key, const T&... payload) { return post(intern(key), payload...); }
+    int dispatch();
+    size_t pending() const { return _ring_tail - _ring_head; }
+    int _post(event_id id, const void *payload, uint32_t size);
+
+    // Typed events: each payload type T gets its own unnamed channel, found
+    // through JCEventType<T>::index() in `_typed`, no string or RTTI per emit.
+    // on<T>(fn) registers fn(const T&), returning int or nothing.
+    // emit<T>(ev) queues ev inline for dispatch(), emitNow<T>(ev) runs at once.
+    std::vector<event_id> _typed;
+    event_id _anonymous();
+
+    template<typename T>
+    event_id channel() {
+        uint32_t index = JCEventType<T>::index();
+        if (index >= _typed.size()) _typed.resize(index + 1, JC_EVENT_INVALID);
+        if (_typed[index] == JC_EVENT_INVALID) _typed[index] = _anonymous();
+        return _typed[index];
+    }
+
+    template<typename T, typename F>
+    subscription_id on(F fn, int place = -1) {
+        return registerEvent(channel<T>(), [fn = std::move(fn)](void *ptr) mutable {
+            const T &ev = *static_cast<const T *>(ptr);
+            if constexpr (std::is_void<decltype(fn(ev))>::value) {
+                fn(ev);
+                return JC_SUCCESS;
+            } else return (int)fn(ev);
+        }, place);
+    }
+
+    template<typename T>
+    int emit(const T &ev) { return post(channel<T>(), ev); }
+
+    template<typename T>
+    int emitNow(const T &ev) { return emitEvent(channel<T>(), const_cast<T *>(&ev)); }
 };
 
 struct JCEventTimerNode {
@@ -50,9 +237,17 @@ struct JCEventTimerNode {
 };
 
 
-template<int buffer_size>
+// Hashed hierarchical timing wheel.
+// Level 0 holds `buffer_size` slots of one tick each, level k holds `buffer_size`
+// slots of buffer_size^k ticks each. Far timers sit in a coarse level and cascade
+// down as the lower level wraps, only timers beyond the top level go to `_waits`.
+// wheel_levels = 1 keeps the single wheel + priority_queue behaviour.
+template<int buffer_size, int wheel_levels = 1>
 struct JCEventTimer {
+    static_assert(wheel_levels >= 1, "JCEventTimer needs at least one wheel level");
+
     int _tick_ms;
+    int64_t _tick_count;
     ms_timepoint _now_tick;
     
     enum EventStatus {
@@ -61,119 +256,340 @@ struct JCEventTimer {
         CANCELED,
     };
     
-    int _node_idx;
-    std::array<int, buffer_size> unused_id;
-    std::array<EventStatus, buffer_size> status;
-    std::array<JCEventTimerNode, buffer_size> _node_pool;
+    // `state` packs generation << 32 | EventStatus, so producers can check and
+    // cancel a handle with one CAS.
+    struct _pool_node {
+        JCEventTimerNode node;
+        uint32_t ev_id;
+        std::atomic<uint64_t> state{1ull << 32 | EMPTY};
+        std::atomic<_pool_node*> _next{nullptr};
+        std::atomic<uint32_t> _free_next{UINT32_MAX};
+        std::atomic<int> _refs{0};
+    };
+
+    // Chunk k holds _pool_base << k nodes, so chunks never move once allocated
+    // and 33 - _pool_base_bits of them cover the whole 32-bit index space.
+    static constexpr int _pool_bits(int x) { return x > 1 ? _pool_bits(x >> 1) + 1 : 0; }
+    static constexpr int _pool_base_bits = _pool_bits(buffer_size);
+    static constexpr uint64_t _pool_base = 1ull << _pool_base_bits;
+    static constexpr int _pool_chunks = 33 - _pool_base_bits;
+
+    std::atomic<uint32_t> _node_count;
+    std::atomic<uint64_t> _free_head;   // tag << 32 | index, Treiber stack through _free_next
+    std::array<std::atomic<_pool_node*>, _pool_chunks> _node_pool;
+
+    // Intrusive MPSC queue (Vyukov) of registered nodes, drained by the timer thread.
+    std::atomic<_pool_node*> _cmd_head;
+    _pool_node* _cmd_tail;
+    _pool_node _cmd_stub;
 
     struct JCEventTimerNodeCmp {
-        const std::array<JCEventTimerNode, buffer_size>* pool;
-        JCEventTimerNodeCmp(const std::array<JCEventTimerNode, buffer_size>* p) : pool(p) {}
-        bool operator()(int i, int j) const noexcept {
-            return (*pool)[i].expire > (*pool)[j].expire;
+        JCEventTimer* timer;
+        JCEventTimerNodeCmp(JCEventTimer* t) : timer(t) {}
+        bool operator()(uint32_t i, uint32_t j) const noexcept {
+            return timer->_at(i).node.expire > timer->_at(j).node.expire;
         }
     };
 
+    static constexpr int64_t _level_span(int level) {
+        int64_t span = 1;
+        while (level--) span *= buffer_size;
+        return span;
+    }
+    static_assert(_level_span(wheel_levels - 1) <= INT64_MAX / buffer_size,
+        "JCEventTimer wheel span overflows int64_t ticks");
+
     int _slot_index;
-    std::priority_queue<int, std::vector<int>, JCEventTimerNodeCmp> _waits;
-    std::array<std::vector<int>, buffer_size> _slots;
+    std::priority_queue<uint32_t, std::vector<uint32_t>, JCEventTimerNodeCmp> _waits;
+    std::array<std::array<std::vector<uint32_t>, buffer_size>, wheel_levels> _slots;
+    // One bit per non-empty slot, lets the tickless thread find the next busy tick.
+    std::array<std::array<uint64_t, (buffer_size + 63) / 64>, wheel_levels> _occupied;
+
+    // Per-tick temporaries of the timer thread, reset at the start of _tick.
+    JCLinearArena _scratch{4096};
 
     using mutex_guard = std::lock_guard<std::mutex>;
-    int running_;
+    std::atomic<int> running_;
     std::mutex mtx;
     std::thread task_thread;
 
-    using error_cmd = std::function<int(int, int)>;
+    // Tickless mode (set before the timer starts): instead of waking every tick,
+    // the thread sleeps until the next busy tick. _sleep_until is the deadline it
+    // sleeps to (steady_clock ticks, 0 while awake); registerEvent only wakes it
+    // when the new timer is due earlier than that.
+    int tickless = 0;
+    int _wake;
+    std::atomic<int64_t> _sleep_until;
+    std::mutex _wake_mtx;
+    std::condition_variable _wake_cv;
+
+    using error_cmd = std::function<int(timer_id, int)>;
     error_cmd error_callback = nullptr;
 
+    // Timers expired in one tick, handed to `executor` instead of being run on
+    // the timer thread. Each entry pins its node, so run() may happen on any
+    // thread and any time later, stop() and setTickMS() included, as long as the
+    // timer itself is still alive; canceled entries are skipped.
+    // A batch that will never run must be dropped, or its nodes are never freed.
+    // The first _inline_ids handles are stored in place, so a usual tick hands
+    // over its batch without touching the heap; the rest spill into _more.
+    struct JCEventTimerBatch {
+        static constexpr uint32_t _inline_ids = 16;
+        JCEventTimer *timer;
+        uint32_t count = 0;
+        timer_id _ids[_inline_ids] = {};
+        std::vector<timer_id> _more;
+
+        JCEventTimerBatch(JCEventTimer *timer = nullptr) : timer(timer) {}
+        void push(timer_id id) {
+            if (count < _inline_ids) _ids[count] = id;
+            else _more.push_back(id);
+            ++count;
+        }
+        timer_id operator[](uint32_t i) const { return i < _inline_ids ? _ids[i] : _more[i - _inline_ids]; }
+        bool empty() const { return count == 0; }
+        int run();
+        void drop();
+    };
+
+    // When set (before the timer starts), _tick only does bookkeeping and
+    // passes each non-empty batch here, e.g. to a thread pool or a main loop.
+    // error_callback is then called from whichever thread runs the batch.
+    using executor_cmd = std::function<void(JCEventTimerBatch)>;
+    executor_cmd executor = nullptr;
+
     JCEventTimer(int tick_ms = 0);
     ~JCEventTimer();
 
     void basic_init();
     int setTickMS(int _tick_ms);
-    int registerEvent(int timeout, int interval, cmd_type callback, void * userdata = nullptr);
-    int cancelEvent(int ev_id);
-    int getEventStatus(int ev_id);
-    int _put_in(int ev_id);
-    int _new_node();
-    int _del_node(int ev_id);
+    int stop();
+    timer_id registerEvent(int timeout, int interval, cmd_type callback, void * userdata = nullptr);
+    int cancelEvent(timer_id id);
+    int getEventStatus(timer_id id);
+    int _put_in(uint32_t ev_id);
+    int64_t _new_node();
+    int _del_node(uint32_t ev_id);
+    void _release(uint32_t ev_id);
+    _pool_node& _at(uint32_t ev_id) const;
+    _pool_node* _lookup(timer_id id, uint64_t *state) const;
+    timer_id _handle(uint32_t ev_id) const;
+    void _push_cmd(_pool_node *p);
+    _pool_node* _pop_cmd();
+    void _drain_cmds();
+    void _push_slot(int level, int slot, uint32_t ev_id);
+    void _clear_slot(int level, int slot);
+    int _first_busy(int level, int from) const;
+    int64_t _ticks_to_next() const;
+    void _advance(int64_t ticks);
+    bool _has_cmds() const;
+    void _sleep(ms_timepoint deadline);
+    void _tickless_step();
+    void _cascade(int level);
     void _stop();
     void _start();
     void _tick();
-    JCEventTimerNode* getJCEventTimerNode(int ev_id);
+    JCEventTimerNode* getJCEventTimerNode(timer_id id);
 };
 
 JCEventTrieNode* JCAllocateEventTrieNode();
 void JCDeallocateEventTrieNode(JCEventTrieNode *node);
 
-template<int buffer_size>
-void JCEventTimer<buffer_size>::basic_init() {
-    _node_idx = buffer_size;
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::basic_init() {
+    _node_count = 0;
+    _free_head = UINT32_MAX;
+    for (auto &chunk : _node_pool) chunk = nullptr;
+    _cmd_head = &_cmd_stub;
+    _cmd_tail = &_cmd_stub;
     _slot_index = 0;
-    std::iota(begin(unused_id), end(unused_id), 0);
-    std::fill(begin(status), end(status), EMPTY);
+    _tick_count = 0;
+    for (auto &level : _occupied) level.fill(0);
+    _wake = false;
+    _sleep_until = 0;
     _now_tick = std::chrono::steady_clock::now();
     running_ = false;
 }
 
-template<int buffer_size>
-JCEventTimer<buffer_size>::JCEventTimer(int tick_ms) : _waits(&_node_pool) {
+template<int buffer_size, int wheel_levels>
+JCEventTimer<buffer_size, wheel_levels>::JCEventTimer(int tick_ms) : _waits(this) {
     basic_init();
-    if (tick_ms == 0) return ;
     _tick_ms = tick_ms;
+    if (tick_ms == 0) return ;
     _start();
 }
 
-template<int buffer_size>
-int JCEventTimer<buffer_size>::setTickMS(int tick_ms) {
+template<int buffer_size, int wheel_levels>
+int JCEventTimer<buffer_size, wheel_levels>::setTickMS(int tick_ms) {
+    mutex_guard lock(mtx);
     _stop();
     _tick_ms = tick_ms;
     _start();
     return JC_SUCCESS;
 }
 
-template<int buffer_size>
-JCEventTimer<buffer_size>::~JCEventTimer() {
+// Timers still registered are canceled, in-flight batches skip them.
+// Their callbacks are released once the last batch pinning them is done.
+template<int buffer_size, int wheel_levels>
+int JCEventTimer<buffer_size, wheel_levels>::stop() {
+    mutex_guard lock(mtx);
     _stop();
+    return JC_SUCCESS;
 }
 
-template<int buffer_size>
-void JCEventTimer<buffer_size>::_stop() {
+template<int buffer_size, int wheel_levels>
+JCEventTimer<buffer_size, wheel_levels>::~JCEventTimer() {
+    _stop();
+    for (auto &chunk : _node_pool) delete[] chunk.load();
+}
+
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::_stop() {
     if (!running_) return ;
     running_ = false;
+    {
+        mutex_guard lock(_wake_mtx);
+        _wake = true;
+    }
+    _wake_cv.notify_one();
     assert(task_thread.joinable());
     task_thread.join();
-    while (!_waits.empty()) _waits.pop();
-    for (int i = 0; i < buffer_size; ++i)
-        _slots[i].clear(), status[i] = EMPTY;
+    // Cancel everything, then drop the references the wheel holds. A node an
+    // in-flight batch still pins is left to it: run() skips it and the last
+    // _release frees it, so the callback is never wiped under a running batch.
+    for (uint32_t i = 0, n = _node_count; i < n; ++i) {
+        uint64_t state = _at(i).state.load(std::memory_order_acquire);
+        while ((state & 0xffffffffu) == WAITING && !_at(i).state.compare_exchange_weak(state,
+            (state & ~0xffffffffull) | CANCELED, std::memory_order_acq_rel)) ;
+    }
+    for (_pool_node *p; (p = _pop_cmd()) != nullptr; ) _release(p->ev_id);
+    while (!_waits.empty()) {
+        uint32_t ev_id = _waits.top();
+        _waits.pop();
+        _release(ev_id);
+    }
+    for (auto &level : _slots)
+        for (auto &slot : level) {
+            for (uint32_t ev_id : slot) _release(ev_id);
+            slot.clear();
+        }
+    for (auto &level : _occupied) level.fill(0);
 }
 
-template<int buffer_size>
-void JCEventTimer<buffer_size>::_start() {
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::_start() {
     running_ = true;
     task_thread = std::thread([this]() {
         #ifdef DEBUG
         jclog << "Task Thread Started...\n";
         #endif
         const auto tick_duration = std::chrono::milliseconds(_tick_ms);
-        this->running_ = true;
         while (this->running_) {
             #ifdef DEBUG 
                 jclog << "Task Thread Calling Tick...\n";
             #endif
+            if (tickless) {
+                _tickless_step();
+                continue;
+            }
             _tick();
             std::this_thread::sleep_until(_now_tick);
         }
     });
 }
 
-template<int buffer_size>
-void JCEventTimer<buffer_size>::_tick() {
-    #ifdef DEBUG
-    jclog << "_tick Aquiring lock\n";
-    #endif
-    mutex_guard lock(mtx);
-    
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::_tickless_step() {
+    // Drain first so new timers take part in choosing the next deadline.
+    _drain_cmds();
+    const auto tick_duration = std::chrono::milliseconds(_tick_ms);
+    int64_t next = _ticks_to_next();
+    auto now = std::chrono::steady_clock::now();
+    if (_now_tick <= now) {
+        // Ticks before `next` have nothing to do, jump over them without work.
+        int64_t due = (now - _now_tick) / tick_duration;
+        _advance(std::min(next, due));
+        _tick();
+        return;
+    }
+    _sleep(next == INT64_MAX ? ms_timepoint::max() : _now_tick + next * tick_duration);
+}
+
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::_sleep(ms_timepoint deadline) {
+    std::unique_lock<std::mutex> lock(_wake_mtx);
+    // Publish the deadline before checking the queue, registerEvent pushes
+    // before reading it, so one of the two always sees the other.
+    _sleep_until.store(deadline.time_since_epoch().count());
+    auto woken = [this]() { return _wake || !running_; };
+    if (!_has_cmds()) {
+        if (deadline == ms_timepoint::max()) _wake_cv.wait(lock, woken);
+        else _wake_cv.wait_until(lock, deadline, woken);
+    }
+    _wake = false;
+    _sleep_until.store(0);
+}
+
+template<int buffer_size, int wheel_levels>
+int64_t JCEventTimer<buffer_size, wheel_levels>::_ticks_to_next() const {
+    int64_t next = INT64_MAX;
+    int offset = _first_busy(0, _slot_index);
+    if (offset != -1) next = offset;
+
+    // Level k only has work on the ticks where its slots cascade.
+    for (int level = 1; level < wheel_levels; ++level) {
+        int64_t span = _level_span(level);
+        int64_t boundary = (_tick_count + span - 1) / span * span;
+        offset = _first_busy(level, (boundary / span) % buffer_size);
+        if (offset != -1) next = std::min(next, boundary - _tick_count + offset * span);
+    }
+
+    if (!_waits.empty()) {
+        const auto tick_duration = std::chrono::milliseconds(_tick_ms);
+        int64_t ahead = (_at(_waits.top()).node.expire - _now_tick) / tick_duration
+            - _level_span(wheel_levels);
+        next = std::min(next, std::max<int64_t>(ahead, 0));
+    }
+    return next;
+}
+
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::_advance(int64_t ticks) {
+    _slot_index = (_slot_index + ticks) % buffer_size;
+    _tick_count += ticks;
+    _now_tick += ticks * std::chrono::milliseconds(_tick_ms);
+}
+
+template<int buffer_size, int wheel_levels>
+int JCEventTimer<buffer_size, wheel_levels>::_first_busy(int level, int from) const {
+    // Offset from `from` (circular) to the first non-empty slot, -1 if none.
+    constexpr int words = (buffer_size + 63) / 64;
+    for (int i = 0; i <= words; ++i) {
+        int w = (from / 64 + i) % words;
+        uint64_t x = _occupied[level][w];
+        if (i == 0) x &= ~0ull << (from % 64);
+        if (i == words) x &= (1ull << (from % 64)) - 1;
+        if (x) return (w * 64 + __builtin_ctzll(x) - from + buffer_size) % buffer_size;
+    }
+    return -1;
+}
+
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::_push_slot(int level, int slot, uint32_t ev_id) {
+    _slots[level][slot].push_back(ev_id);
+    _occupied[level][slot / 64] |= 1ull << (slot % 64);
+}
+
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::_clear_slot(int level, int slot) {
+    _slots[level][slot].clear();
+    _occupied[level][slot / 64] &= ~(1ull << (slot % 64));
+}
+
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::_tick() {
+    _drain_cmds();
+
     std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(
                   _now_tick.time_since_epoch());
     #ifdef DEBUG
@@ -182,21 +598,40 @@ void JCEventTimer<buffer_size>::_tick() {
         << _slot_index << "\n";
     #endif
 
-    std::vector<int> retimer;
-    for (int ev_id : _slots[_slot_index]) {
-        if (status[ev_id] == CANCELED) {
-            _del_node(ev_id);
+    // Pull coarse levels down first, so timers due this tick reach _slots[0].
+    for (int level = wheel_levels - 1; level > 0; --level)
+        if (_tick_count % _level_span(level) == 0) _cascade(level);
+
+    _scratch.reset();
+    JCFrameVector<uint32_t> retimer{JCArenaAllocator<uint32_t>(_scratch)};
+    retimer.reserve(_slots[0][_slot_index].size());
+    JCEventTimerBatch batch(this);
+    for (uint32_t ev_id : _slots[0][_slot_index]) {
+        auto status = _at(ev_id).state.load(std::memory_order_acquire) & 0xffffffffu;
+        if (status == CANCELED) {
+            _release(ev_id);
             continue;
         }
         
-        if (status[ev_id] == EMPTY) continue;
+        if (status == EMPTY) continue;
+
+        auto task = &_at(ev_id).node;
+        if (executor != nullptr) {
+            // The batch holds its own reference, the wheel keeps one only while periodic.
+            _at(ev_id)._refs.fetch_add(1, std::memory_order_relaxed);
+            batch.push(_handle(ev_id));
+            if (task->interval != 0) {
+                task->expire += std::chrono::milliseconds(task->interval);
+                retimer.push_back(ev_id);
+            } else _release(ev_id);
+            continue;
+        }
 
-        auto task = &_node_pool[ev_id];
         int ret_code = task->callback(task->userdata);
         if (ret_code != JC_SUCCESS && error_callback != nullptr) {
-            ret_code = error_callback(ev_id, ret_code);
+            ret_code = error_callback(_handle(ev_id), ret_code);
             if (ret_code == JC_TERMINATE) {
-                _del_node(ev_id);
+                _release(ev_id);
                 continue;
             }
         }
@@ -204,61 +639,230 @@ void JCEventTimer<buffer_size>::_tick() {
         if (task->interval != 0) {
             task->expire += std::chrono::milliseconds(task->interval);
             retimer.push_back(ev_id);
-        } else _del_node(ev_id);
+        } else _release(ev_id);
     }
 
     // Put far away events in _waits in _slots.
-    _slots[_slot_index].clear();
+    _clear_slot(0, _slot_index);
     const auto tick_duration = std::chrono::milliseconds(_tick_ms);
-    ms_timepoint _slots_end_tick = _now_tick + buffer_size * tick_duration;
-    while (!_waits.empty() && _node_pool[_waits.top()].expire < _slots_end_tick) {
-        if (status[_waits.top()] == CANCELED) _del_node(_waits.top());
+    ms_timepoint _slots_end_tick = _now_tick + _level_span(wheel_levels) * tick_duration;
+    while (!_waits.empty() && _at(_waits.top()).node.expire < _slots_end_tick) {
+        if ((_at(_waits.top()).state & 0xffffffffu) == CANCELED) _release(_waits.top());
         else retimer.push_back(_waits.top());
         _waits.pop();
     }
 
     _slot_index += 1;
     if (_slot_index == buffer_size) _slot_index = 0;
+    _tick_count += 1;
     _now_tick += tick_duration;
     
-    for (int ev_id : retimer) _put_in(ev_id);
+    for (uint32_t ev_id : retimer) _put_in(ev_id);
+    if (!batch.empty()) executor(std::move(batch));
+}
+
+template<int buffer_size, int wheel_levels>
+int JCEventTimer<buffer_size, wheel_levels>::JCEventTimerBatch::run() {
+    int result = JC_SUCCESS;
+    for (uint32_t i = 0; i < count; ++i) {
+        timer_id id = (*this)[i];
+        uint32_t ev_id = id & 0xffffffffu;
+        _pool_node &p = timer->_at(ev_id);
+        // The pin keeps the generation, canceled ones (stop() included) are skipped.
+        if ((p.state.load(std::memory_order_acquire) & 0xffffffffu) == WAITING) {
+            int ret_code = p.node.callback(p.node.userdata);
+            if (ret_code != JC_SUCCESS) result = JC_ERROR;
+            if (ret_code != JC_SUCCESS && timer->error_callback != nullptr
+                && timer->error_callback(id, ret_code) == JC_TERMINATE)
+                timer->cancelEvent(id);
+        }
+        timer->_release(ev_id);
+    }
+    return result;
+}
+
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::JCEventTimerBatch::drop() {
+    for (uint32_t i = 0; i < count; ++i)
+        timer->_release((*this)[i] & 0xffffffffu);
+    count = 0;
+    _more.clear();
+}
+
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::_cascade(int level) {
+    // Every timer in this slot is due within _level_span(level) ticks,
+    // so _put_in always lands it on a lower level, never back in this slot.
+    int index = (_tick_count / _level_span(level)) % buffer_size;
+    auto &slot = _slots[level][index];
+    #ifdef DEBUG
+    jclog << "cascade " << slot.size() << " events from level " << level << '\n';
+    #endif
+    for (uint32_t ev_id : slot) {
+        auto status = _at(ev_id).state.load(std::memory_order_acquire) & 0xffffffffu;
+        if (status == CANCELED) _release(ev_id);
+        else if (status == WAITING) _put_in(ev_id);
+    }
+    _clear_slot(level, index);
 }
 
-template<int buffer_size>
-int JCEventTimer<buffer_size>::_del_node(int ev_id) {
-    unused_id[_node_idx++] = ev_id;
-    status[ev_id] = EMPTY;
+template<int buffer_size, int wheel_levels>
+typename JCEventTimer<buffer_size, wheel_levels>::_pool_node&
+JCEventTimer<buffer_size, wheel_levels>::_at(uint32_t ev_id) const {
+    uint64_t x = ev_id + _pool_base;
+    int high = 63 - __builtin_clzll(x);
+    return _node_pool[high - _pool_base_bits].load(std::memory_order_acquire)[x - (1ull << high)];
+}
+
+template<int buffer_size, int wheel_levels>
+typename JCEventTimer<buffer_size, wheel_levels>::_pool_node*
+JCEventTimer<buffer_size, wheel_levels>::_lookup(timer_id id, uint64_t *state) const {
+    uint32_t ev_id = id & 0xffffffffu;
+    if (ev_id >= _node_count.load(std::memory_order_acquire)) return nullptr;
+    uint64_t x = ev_id + _pool_base;
+    if (_node_pool[63 - __builtin_clzll(x) - _pool_base_bits].load(std::memory_order_acquire) == nullptr)
+        return nullptr;
+    _pool_node &p = _at(ev_id);
+    *state = p.state.load(std::memory_order_acquire);
+    return (*state >> 32) == (id >> 32) ? &p : nullptr;
+}
+
+template<int buffer_size, int wheel_levels>
+timer_id JCEventTimer<buffer_size, wheel_levels>::_handle(uint32_t ev_id) const {
+    return (_at(ev_id).state.load(std::memory_order_acquire) & ~0xffffffffull) | ev_id;
+}
+
+// Whoever drops the last reference frees the node; any thread may pop it in _new_node.
+template<int buffer_size, int wheel_levels>
+int JCEventTimer<buffer_size, wheel_levels>::_del_node(uint32_t ev_id) {
+    _pool_node &p = _at(ev_id);
+    p.node.callback = nullptr;
+    p._refs.store(0, std::memory_order_relaxed);
+    // Bump the generation so handles of the old timer go stale.
+    uint32_t generation = (p.state.load(std::memory_order_relaxed) >> 32) + 1;
+    if (generation == 0) generation = 1;
+    p.state.store((uint64_t)generation << 32 | EMPTY, std::memory_order_release);
+
+    uint64_t head = _free_head.load(std::memory_order_relaxed);
+    do {
+        p._free_next.store(head & 0xffffffffu, std::memory_order_relaxed);
+    } while (!_free_head.compare_exchange_weak(head,
+        ((head >> 32) + 1) << 32 | ev_id, std::memory_order_release, std::memory_order_relaxed));
     return JC_SUCCESS;
 }
 
-template<int buffer_size>
-int JCEventTimer<buffer_size>::_new_node() {
-    if (_node_idx == 0)
-        return -1;
-    int ev_id = unused_id[--_node_idx];
+// Drops one reference (wheel or in-flight batch), the last one frees the node.
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::_release(uint32_t ev_id) {
+    if (_at(ev_id)._refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        _del_node(ev_id);
+}
+
+template<int buffer_size, int wheel_levels>
+int64_t JCEventTimer<buffer_size, wheel_levels>::_new_node() {
+    // The tag in the high half of _free_head keeps the pop ABA-safe.
+    uint64_t head = _free_head.load(std::memory_order_acquire);
+    while ((head & 0xffffffffu) != UINT32_MAX) {
+        uint32_t ev_id = head & 0xffffffffu;
+        uint32_t next = _at(ev_id)._free_next.load(std::memory_order_relaxed);
+        if (_free_head.compare_exchange_weak(head, ((head >> 32) + 1) << 32 | next,
+                std::memory_order_acquire, std::memory_order_acquire))
+            return ev_id;
+    }
+
+    uint32_t ev_id = _node_count.load(std::memory_order_relaxed);
+    uint64_t x, chunk;
+    do {
+        if (ev_id == UINT32_MAX) return -1;
+        x = ev_id + _pool_base;
+        chunk = 63 - __builtin_clzll(x) - _pool_base_bits;
+        // Publish the chunk before the index becomes visible through _node_count.
+        if (_node_pool[chunk].load(std::memory_order_acquire) == nullptr) {
+            _pool_node *fresh = new _pool_node[_pool_base << chunk], *expect = nullptr;
+            if (!_node_pool[chunk].compare_exchange_strong(expect, fresh, std::memory_order_acq_rel))
+                delete[] fresh;
+        }
+    } while (!_node_count.compare_exchange_weak(ev_id, ev_id + 1, std::memory_order_acq_rel));
     return ev_id;
 }
 
-template<int buffer_size>
-int JCEventTimer<buffer_size>::cancelEvent(int ev_id) {
-    mutex_guard lock(mtx);
-    if (status[ev_id] == WAITING) status[ev_id] = CANCELED;
-    return status[ev_id] == CANCELED;
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::_push_cmd(_pool_node *p) {
+    p->_next.store(nullptr, std::memory_order_relaxed);
+    _pool_node *prev = _cmd_head.exchange(p);
+    prev->_next.store(p, std::memory_order_release);
 }
 
-template<int buffer_size>
-int JCEventTimer<buffer_size>::getEventStatus(int ev_id) {
-    mutex_guard lock(mtx);
-    return status[ev_id];
+template<int buffer_size, int wheel_levels>
+typename JCEventTimer<buffer_size, wheel_levels>::_pool_node*
+JCEventTimer<buffer_size, wheel_levels>::_pop_cmd() {
+    _pool_node *tail = _cmd_tail, *next = tail->_next.load(std::memory_order_acquire);
+    if (tail == &_cmd_stub) {
+        if (next == nullptr) return nullptr;
+        _cmd_tail = tail = next;
+        next = next->_next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+        _cmd_tail = next;
+        return tail;
+    }
+    // A producer is between exchange and link, pick it up on the next drain.
+    if (tail != _cmd_head.load(std::memory_order_acquire)) return nullptr;
+    _push_cmd(&_cmd_stub);
+    next = tail->_next.load(std::memory_order_acquire);
+    if (next == nullptr) return nullptr;
+    _cmd_tail = next;
+    return tail;
+}
+
+template<int buffer_size, int wheel_levels>
+bool JCEventTimer<buffer_size, wheel_levels>::_has_cmds() const {
+    // Quiescent and empty exactly when both ends sit on the stub.
+    return _cmd_tail != &_cmd_stub || _cmd_head.load() != &_cmd_stub;
+}
+
+template<int buffer_size, int wheel_levels>
+void JCEventTimer<buffer_size, wheel_levels>::_drain_cmds() {
+    for (_pool_node *p; (p = _pop_cmd()) != nullptr; ) {
+        if ((p->state.load(std::memory_order_acquire) & 0xffffffffu) == CANCELED) {
+            _release(p->ev_id);
+            continue;
+        }
+        _put_in(p->ev_id);
+    }
 }
 
-template<int buffer_size>
-int JCEventTimer<buffer_size>::_put_in(int ev_id) {
-    assert(status[ev_id] == WAITING);
+template<int buffer_size, int wheel_levels>
+int JCEventTimer<buffer_size, wheel_levels>::cancelEvent(timer_id id) {
+    uint64_t state;
+    _pool_node *p = _lookup(id, &state);
+    if (p == nullptr) return false;
+    uint64_t waiting = (id & ~0xffffffffull) | WAITING;
+    uint64_t canceled = (id & ~0xffffffffull) | CANCELED;
+    return p->state.compare_exchange_strong(waiting, canceled, std::memory_order_acq_rel)
+        || waiting == canceled;
+}
+
+template<int buffer_size, int wheel_levels>
+int JCEventTimer<buffer_size, wheel_levels>::getEventStatus(timer_id id) {
+    uint64_t state;
+    return _lookup(id, &state) == nullptr ? EMPTY : state & 0xffffffffu;
+}
+
+template<int buffer_size, int wheel_levels>
+JCEventTimerNode* JCEventTimer<buffer_size, wheel_levels>::getJCEventTimerNode(timer_id id) {
+    uint64_t state;
+    _pool_node *p = _lookup(id, &state);
+    return p == nullptr || (state & 0xffffffffu) == EMPTY ? nullptr : &p->node;
+}
+
+template<int buffer_size, int wheel_levels>
+int JCEventTimer<buffer_size, wheel_levels>::_put_in(uint32_t ev_id) {
+    assert((_at(ev_id).state & 0xffffffffu) != EMPTY);
     #ifdef DEBUG
     jclog << "put in " << ev_id << " with expire " <<
-        std::chrono::duration_cast<std::chrono::milliseconds>(_node_pool[ev_id].expire.time_since_epoch()).count()
-        << " and interval " << _node_pool[ev_id].interval << "ms\n";
+        std::chrono::duration_cast<std::chrono::milliseconds>(_at(ev_id).node.expire.time_since_epoch()).count()
+        << " and interval " << _at(ev_id).node.interval << "ms\n";
     #endif
 
     if (_tick_ms == 0) {
@@ -267,53 +871,82 @@ int JCEventTimer<buffer_size>::_put_in(int ev_id) {
     }
     
     const auto tick_duration = std::chrono::milliseconds(_tick_ms);
-    ms_timepoint _slots_end_tick = _now_tick + (buffer_size - 1) * tick_duration;
 
-    auto expire = _node_pool[ev_id].expire;
+    auto expire = _at(ev_id).node.expire;
     if (expire < _now_tick) {
-        _slots[_slot_index].push_back(ev_id);
+        _push_slot(0, _slot_index, ev_id);
         #ifdef DEBUG
         jclog << "put " << ev_id << " in " << _slot_index << '\n';
         #endif
         return JC_SUCCESS;
     }
     
-    int t = (expire - _now_tick - std::chrono::milliseconds(1)) / tick_duration + 1;
-    if (t >= buffer_size) _waits.push(ev_id);
-    else _slots[(_slot_index + t) % buffer_size].push_back(ev_id);
+    // Round up, expire comes from the clock and is not aligned to ticks.
+    int64_t t = (expire - _now_tick + tick_duration - std::chrono::nanoseconds(1)) / tick_duration;
+    if (t < buffer_size) {
+        _push_slot(0, (_slot_index + t) % buffer_size, ev_id);
+        #ifdef DEBUG
+        jclog << "put " << ev_id << " in " << (_slot_index + t) % buffer_size << '\n';
+        #endif
+        return JC_SUCCESS;
+    }
 
+    // Slot of level k is picked by the absolute tick, so it is cascaded
+    // exactly when the lower levels have wrapped up to the expire tick.
+    int64_t when = _tick_count + t;
+    for (int level = 1; level < wheel_levels; ++level) {
+        if (t >= _level_span(level + 1)) continue;
+        _push_slot(level, (when / _level_span(level)) % buffer_size, ev_id);
+        #ifdef DEBUG
+        jclog << "put " << ev_id << " in level " << level << '\n';
+        #endif
+        return JC_SUCCESS;
+    }
+
+    _waits.push(ev_id);
     #ifdef DEBUG
-    if (t >= buffer_size) jclog << "put " << ev_id << " in _waits\n";
-    jclog << "put " << ev_id << " in " << (_slot_index + t) % buffer_size << '\n';
+    jclog << "put " << ev_id << " in _waits\n";
     #endif
-
     return JC_SUCCESS;
 }
 
-template<int buffer_size>
-int JCEventTimer<buffer_size>::registerEvent(int timeout, int interval, cmd_type callback, void * userdata) {
-    mutex_guard lock(mtx);
-    int ev_id = _new_node();
-    if (ev_id == -1) return -1;
-
-    assert(status[ev_id] == EMPTY);
-    status[ev_id] = WAITING;
-    _node_pool[ev_id] = {
-        _now_tick + std::chrono::milliseconds(timeout),
-        interval,
-        callback,
-        userdata,
-    };
+// Lock-free, callable from any thread: the node is filled here and handed to
+// the timer thread through the command queue.
+template<int buffer_size, int wheel_levels>
+timer_id JCEventTimer<buffer_size, wheel_levels>::registerEvent(int timeout, int interval, cmd_type callback, void * userdata) {
+    int64_t ev_id = _new_node();
+    if (ev_id == -1) return JC_TIMER_INVALID;
+
+    _pool_node &p = _at(ev_id);
+    uint64_t state = p.state.load(std::memory_order_acquire);
+    assert((state & 0xffffffffu) == EMPTY);
+    p.ev_id = ev_id;
+    // Taken from the clock rather than _now_tick, which only the timer thread
+    // may read and which lags behind while a tickless thread sleeps.
+    ms_timepoint expire = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    p.node.expire = expire;
+    p.node.interval = interval;
+    p.node.callback = std::move(callback);
+    p.node.userdata = userdata;
+    p._refs.store(1, std::memory_order_relaxed);
+    state = (state & ~0xffffffffull) | WAITING;
+    p.state.store(state, std::memory_order_release);
 
     #ifdef DEBUG
-    jclog << "new event expire at "
-        << std::chrono::duration_cast<std::chrono::milliseconds>(
-            _node_pool[ev_id].expire.time_since_epoch()).count()
-        << "\n";
+    jclog << "new event " << ev_id << " expire in " << timeout << "ms\n";
     #endif
 
-    assert(_put_in(ev_id) == JC_SUCCESS);
-    return ev_id;
+    _push_cmd(&p);
+    if (tickless) {
+        if (expire.time_since_epoch().count() < _sleep_until.load()) {
+            {
+                mutex_guard lock(_wake_mtx);
+                _wake = true;
+            }
+            _wake_cv.notify_one();
+        }
+    }
+    return (state & ~0xffffffffull) | ev_id;
 }
 
 
@@ -0,0 +1,116 @@
+#ifndef _JCENGINE_FUNC_H_
+#define _JCENGINE_FUNC_H_
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include <jc_base.h>
+
+#define JC_INLINE_FUNCTION_SIZE 48
+
+template<typename Sig, size_t inline_size = JC_INLINE_FUNCTION_SIZE>
+struct JCInlineFunction;
+
+// Move-only replacement of std::function. Callables up to `inline_size` bytes
+// live in the object itself, larger ones fall back to one heap allocation.
+template<typename R, typename... Args, size_t inline_size>
+struct JCInlineFunction<R(Args...), inline_size> {
+    struct _ops {
+        R (*invoke)(void *self, Args... args);
+        void (*relocate)(void *from, void *to);  // move-construct to `to`, destroy `from`
+        void (*destroy)(void *self);
+    };
+
+    template<typename F>
+    static constexpr bool _fits = sizeof(F) <= inline_size
+        && alignof(F) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible<F>::value;
+
+    template<typename F>
+    struct _inline_ops {
+        static R invoke(void *self, Args... args) {
+            return (*static_cast<F*>(self))(std::forward<Args>(args)...);
+        }
+        static void relocate(void *from, void *to) {
+            new (to) F(std::move(*static_cast<F*>(from)));
+            static_cast<F*>(from)->~F();
+        }
+        static void destroy(void *self) { static_cast<F*>(self)->~F(); }
+        static constexpr _ops table{invoke, relocate, destroy};
+    };
+
+    template<typename F>
+    struct _heap_ops {
+        static R invoke(void *self, Args... args) {
+            return (**static_cast<F**>(self))(std::forward<Args>(args)...);
+        }
+        static void relocate(void *from, void *to) { *static_cast<F**>(to) = *static_cast<F**>(from); }
+        static void destroy(void *self) { delete *static_cast<F**>(self); }
+        static constexpr _ops table{invoke, relocate, destroy};
+    };
+
+    alignas(std::max_align_t) unsigned char _buffer[inline_size < sizeof(void*) ? sizeof(void*) : inline_size];
+    const _ops *_table;
+
+    JCInlineFunction() noexcept : _table(nullptr) {}
+    JCInlineFunction(std::nullptr_t) noexcept : _table(nullptr) {}
+
+    template<typename F, typename D = typename std::decay<F>::type,
+        typename = typename std::enable_if<!std::is_same<D, JCInlineFunction>::value>::type>
+    JCInlineFunction(F&& f) : _table(nullptr) {
+        _assign<D>(std::forward<F>(f));
+    }
+
+    JCInlineFunction(JCInlineFunction&& other) noexcept : _table(other._table) {
+        if (_table != nullptr) _table->relocate(other._buffer, _buffer);
+        other._table = nullptr;
+    }
+
+    JCInlineFunction& operator=(JCInlineFunction&& other) noexcept {
+        if (this == &other) return *this;
+        reset();
+        _table = other._table;
+        if (_table != nullptr) _table->relocate(other._buffer, _buffer);
+        other._table = nullptr;
+        return *this;
+    }
+
+    JCInlineFunction& operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    JCInlineFunction(const JCInlineFunction& other) = delete;
+    JCInlineFunction& operator=(const JCInlineFunction& other) = delete;
+
+    ~JCInlineFunction() { reset(); }
+
+    void reset() noexcept {
+        if (_table != nullptr) _table->destroy(_buffer);
+        _table = nullptr;
+    }
+
+    explicit operator bool() const noexcept { return _table != nullptr; }
+    bool operator==(std::nullptr_t) const noexcept { return _table == nullptr; }
+    bool operator!=(std::nullptr_t) const noexcept { return _table != nullptr; }
+
+    // Like std::function, calling through a const reference may still mutate the callable.
+    R operator()(Args... args) const {
+        return _table->invoke(const_cast<unsigned char*>(_buffer), std::forward<Args>(args)...);
+    }
+
+    template<typename D, typename F>
+    void _assign(F&& f) {
+        if constexpr (_fits<D>) {
+            new (_buffer) D(std::forward<F>(f));
+            _table = &_inline_ops<D>::table;
+        } else {
+            *reinterpret_cast<D**>(_buffer) = new D(std::forward<F>(f));
+            _table = &_heap_ops<D>::table;
+        }
+    }
+};
+
+#endif // _JCENGINE_FUNC_H_
@@ -7,17 +7,26 @@
 #include <SDL3_image/SDL_image.h>
 #include <jc_base.h>
 #include <jc_entry.h>
+#include <jc_transform.h>
+
+static_assert(sizeof(JCRect) == sizeof(SDL_FRect), "JCRect must match SDL_FRect");
 
 struct JCImage {
     SDL_Renderer *ren;
     SDL_Surface *sur;
     SDL_Texture *text;
     SDL_FRect location;
+    // Once bound, drawn at the transform's world rect and angle instead of location.
+    JCTransforms *transforms;
+    slot_id transform = JC_SLOT_INVALID;
 
     JCImage(JCEntry& entry);
     int open(const std::string& name);
     bool update();
+    // Same as update, through the batch: drawn at its next flush.
+    void enqueue(JCSpriteBatch &batch, int layer = 0);
     void setLoc(SDL_FRect rect);
+    slot_id bindTransform();
     void getSize(int *w, int *h);
 };
 
@@ -2,9 +2,488 @@
 #define _JCENGINE_MATH_H_
 
 #include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <ostream>
+#include <type_traits>
+
+#include <jc_worker.h>
+
+// SSE2 is baseline on x86-64; AVX only when the compiler targets it (-mavx).
+// JC_NO_SIMD forces the scalar kernels, e.g. on other architectures.
+#if !defined(JC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define JC_SIMD_SSE 1
+#include <immintrin.h>
+#if defined(__AVX__)
+#define JC_SIMD_AVX 1
+#endif
+#endif
+
+// Lets constexpr kernels take the SIMD path at runtime only.
+#if defined(__clang__)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define JC_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#elif (defined(__GNUC__) && __GNUC__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+#define JC_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#ifndef JC_CONSTANT_EVALUATED
+#define JC_CONSTANT_EVALUATED() true
+#endif
+
+struct Vec2 {
+    float x, y;
+
+    constexpr Vec2() : x(0), y(0) {}
+    constexpr Vec2(float x, float y) : x(x), y(y) {}
+
+    constexpr Vec2 operator+ (const Vec2 &b) const { return {x + b.x, y + b.y}; }
+    constexpr Vec2 operator- (const Vec2 &b) const { return {x - b.x, y - b.y}; }
+    constexpr Vec2 operator* (const Vec2 &b) const { return {x * b.x, y * b.y}; }
+    constexpr Vec2 operator* (float k) const { return {x * k, y * k}; }
+    constexpr Vec2 operator/ (float k) const { return {x / k, y / k}; }
+    constexpr Vec2 operator- () const { return {-x, -y}; }
+    constexpr Vec2& operator+= (const Vec2 &b) { x += b.x, y += b.y; return *this; }
+    constexpr Vec2& operator-= (const Vec2 &b) { x -= b.x, y -= b.y; return *this; }
+    constexpr Vec2& operator*= (float k) { x *= k, y *= k; return *this; }
+    constexpr bool operator== (const Vec2 &b) const { return x == b.x && y == b.y; }
+    constexpr bool operator!= (const Vec2 &b) const { return !(*this == b); }
+
+    constexpr float dot(const Vec2 &b) const { return x * b.x + y * b.y; }
+    float length() const { return std::sqrt(dot(*this)); }
+};
+
+struct Vec3 {
+    float x, y, z;
+
+    constexpr Vec3() : x(0), y(0), z(0) {}
+    constexpr Vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+
+    constexpr Vec3 operator+ (const Vec3 &b) const { return {x + b.x, y + b.y, z + b.z}; }
+    constexpr Vec3 operator- (const Vec3 &b) const { return {x - b.x, y - b.y, z - b.z}; }
+    constexpr Vec3 operator* (const Vec3 &b) const { return {x * b.x, y * b.y, z * b.z}; }
+    constexpr Vec3 operator* (float k) const { return {x * k, y * k, z * k}; }
+    constexpr Vec3 operator/ (float k) const { return {x / k, y / k, z / k}; }
+    constexpr Vec3 operator- () const { return {-x, -y, -z}; }
+    constexpr Vec3& operator+= (const Vec3 &b) { x += b.x, y += b.y, z += b.z; return *this; }
+    constexpr Vec3& operator-= (const Vec3 &b) { x -= b.x, y -= b.y, z -= b.z; return *this; }
+    constexpr Vec3& operator*= (float k) { x *= k, y *= k, z *= k; return *this; }
+    constexpr bool operator== (const Vec3 &b) const { return x == b.x && y == b.y && z == b.z; }
+    constexpr bool operator!= (const Vec3 &b) const { return !(*this == b); }
+
+    constexpr float dot(const Vec3 &b) const { return x * b.x + y * b.y + z * b.z; }
+    constexpr Vec3 cross(const Vec3 &b) const {
+        return {y * b.z - z * b.y, z * b.x - x * b.z, x * b.y - y * b.x};
+    }
+    float length() const { return std::sqrt(dot(*this)); }
+    Vec3 normalized() const { return *this / length(); }
+};
+
+// 16-byte aligned, one SSE register.
+struct alignas(16) Vec4 {
+    float x, y, z, w;
+
+    constexpr Vec4() : x(0), y(0), z(0), w(0) {}
+    constexpr Vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+    constexpr Vec4(const Vec3 &v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+
+    constexpr Vec4 operator+ (const Vec4 &b) const { return {x + b.x, y + b.y, z + b.z, w + b.w}; }
+    constexpr Vec4 operator- (const Vec4 &b) const { return {x - b.x, y - b.y, z - b.z, w - b.w}; }
+    constexpr Vec4 operator* (const Vec4 &b) const { return {x * b.x, y * b.y, z * b.z, w * b.w}; }
+    constexpr Vec4 operator* (float k) const { return {x * k, y * k, z * k, w * k}; }
+    constexpr Vec4 operator/ (float k) const { return {x / k, y / k, z / k, w / k}; }
+    constexpr Vec4 operator- () const { return {-x, -y, -z, -w}; }
+    constexpr bool operator== (const Vec4 &b) const { return x == b.x && y == b.y && z == b.z && w == b.w; }
+    constexpr bool operator!= (const Vec4 &b) const { return !(*this == b); }
+
+    constexpr float dot(const Vec4 &b) const { return x * b.x + y * b.y + z * b.z + w * b.w; }
+    constexpr Vec3 xyz() const { return {x, y, z}; }
+    float length() const { return std::sqrt(dot(*this)); }
+};
+
+// Row-major like Matrix<T>, vectors are columns: M * v.
+struct Mat3 {
+    float m[3][3] {};
+
+    constexpr Mat3() {}
+    constexpr Mat3(float a00, float a01, float a02,
+                   float a10, float a11, float a12,
+                   float a20, float a21, float a22)
+        : m{{a00, a01, a02}, {a10, a11, a12}, {a20, a21, a22}} {}
+
+    static constexpr Mat3 identity() { return {1, 0, 0, 0, 1, 0, 0, 0, 1}; }
+
+    constexpr Mat3 operator* (const Mat3 &b) const {
+        Mat3 c;
+        for (int i = 0; i < 3; ++i)
+            for (int k = 0; k < 3; ++k)
+                for (int j = 0; j < 3; ++j)
+                    c.m[i][j] += m[i][k] * b.m[k][j];
+        return c;
+    }
+
+    constexpr Vec3 operator* (const Vec3 &v) const {
+        return {m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+                m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+                m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z};
+    }
+
+    constexpr bool operator== (const Mat3 &b) const {
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                if (m[i][j] != b.m[i][j]) return false;
+        return true;
+    }
+
+    constexpr Mat3 transpose() const {
+        return {m[0][0], m[1][0], m[2][0], m[0][1], m[1][1], m[2][1], m[0][2], m[1][2], m[2][2]};
+    }
+
+    constexpr float determinant() const {
+        return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+             - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+             + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    }
+
+    // Assumes the matrix is invertible, check determinant() first if unsure.
+    constexpr Mat3 inverse() const {
+        float inv = 1.0f / determinant();
+        return {(m[1][1] * m[2][2] - m[1][2] * m[2][1]) * inv,
+                (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv,
+                (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv,
+                (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * inv,
+                (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv,
+                (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv,
+                (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * inv,
+                (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv,
+                (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv};
+    }
+};
+
+// Row-major, each row one SSE register. The operators are constexpr and take
+// the SSE/AVX kernels at runtime; the _scalar kernels are what they fall back to.
+struct alignas(16) Mat4 {
+    float m[4][4] {};
+
+    constexpr Mat4() {}
+    constexpr Mat4(float a00, float a01, float a02, float a03,
+                   float a10, float a11, float a12, float a13,
+                   float a20, float a21, float a22, float a23,
+                   float a30, float a31, float a32, float a33)
+        : m{{a00, a01, a02, a03}, {a10, a11, a12, a13}, {a20, a21, a22, a23}, {a30, a31, a32, a33}} {}
+
+    static constexpr Mat4 identity() { return {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}; }
+    static constexpr Mat4 translation(const Vec3 &t) {
+        return {1, 0, 0, t.x, 0, 1, 0, t.y, 0, 0, 1, t.z, 0, 0, 0, 1};
+    }
+    static constexpr Mat4 scale(const Vec3 &s) {
+        return {s.x, 0, 0, 0, 0, s.y, 0, 0, 0, 0, s.z, 0, 0, 0, 0, 1};
+    }
+
+    constexpr Mat4 operator* (const Mat4 &b) const {
+        #ifdef JC_SIMD_SSE
+        if (!JC_CONSTANT_EVALUATED()) return _mul_simd(*this, b);
+        #endif
+        return _mul_scalar(*this, b);
+    }
+
+    constexpr Vec4 operator* (const Vec4 &v) const {
+        #ifdef JC_SIMD_SSE
+        if (!JC_CONSTANT_EVALUATED()) return _transform_simd(*this, v);
+        #endif
+        return _transform_scalar(*this, v);
+    }
+
+    constexpr bool operator== (const Mat4 &b) const {
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                if (m[i][j] != b.m[i][j]) return false;
+        return true;
+    }
+
+    constexpr Mat4 transpose() const {
+        #ifdef JC_SIMD_SSE
+        if (!JC_CONSTANT_EVALUATED()) return _transpose_simd(*this);
+        #endif
+        return _transpose_scalar(*this);
+    }
+
+    constexpr float determinant() const;
+
+    // Assumes the matrix is invertible, check determinant() first if unsure.
+    constexpr Mat4 inverse() const {
+        #ifdef JC_SIMD_SSE
+        if (!JC_CONSTANT_EVALUATED()) return _inverse_simd(*this);
+        #endif
+        return _inverse_scalar(*this);
+    }
+
+    static constexpr Mat4 _mul_scalar(const Mat4 &a, const Mat4 &b) {
+        Mat4 c;
+        for (int i = 0; i < 4; ++i)
+            for (int k = 0; k < 4; ++k)
+                for (int j = 0; j < 4; ++j)
+                    c.m[i][j] += a.m[i][k] * b.m[k][j];
+        return c;
+    }
+
+    static constexpr Vec4 _transform_scalar(const Mat4 &a, const Vec4 &v) {
+        return {a.m[0][0] * v.x + a.m[0][1] * v.y + a.m[0][2] * v.z + a.m[0][3] * v.w,
+                a.m[1][0] * v.x + a.m[1][1] * v.y + a.m[1][2] * v.z + a.m[1][3] * v.w,
+                a.m[2][0] * v.x + a.m[2][1] * v.y + a.m[2][2] * v.z + a.m[2][3] * v.w,
+                a.m[3][0] * v.x + a.m[3][1] * v.y + a.m[3][2] * v.z + a.m[3][3] * v.w};
+    }
+
+    static constexpr Mat4 _transpose_scalar(const Mat4 &a) {
+        Mat4 t;
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                t.m[i][j] = a.m[j][i];
+        return t;
+    }
+
+    static constexpr Mat4 _inverse_scalar(const Mat4 &a);
+
+    #ifdef JC_SIMD_SSE
+    static Mat4 _mul_simd(const Mat4 &a, const Mat4 &b);
+    static Vec4 _transform_simd(const Mat4 &a, const Vec4 &v);
+    static Mat4 _transpose_simd(const Mat4 &a);
+    static Mat4 _inverse_simd(const Mat4 &a);
+    #endif
+};
+
+// 2x2 minors of the top (s) and bottom (c) row pairs, shared by
+// determinant() and the scalar inverse.
+struct _Mat4Minors {
+    float s[6], c[6];
+
+    constexpr _Mat4Minors(const Mat4 &a) : s{}, c{} {
+        auto &m = a.m;
+        s[0] = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+        s[1] = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+        s[2] = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+        s[3] = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+        s[4] = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+        s[5] = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+        c[0] = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+        c[1] = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+        c[2] = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+        c[3] = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+        c[4] = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+        c[5] = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+    }
+
+    constexpr float determinant() const {
+        return s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0];
+    }
+};
+
+constexpr float Mat4::determinant() const {
+    return _Mat4Minors(*this).determinant();
+}
+
+constexpr Mat4 Mat4::_inverse_scalar(const Mat4 &a) {
+    _Mat4Minors d(a);
+    const float *s = d.s, *c = d.c;
+    auto &m = a.m;
+    float inv = 1.0f / d.determinant();
+    return {( m[1][1] * c[5] - m[1][2] * c[4] + m[1][3] * c[3]) * inv,
+            (-m[0][1] * c[5] + m[0][2] * c[4] - m[0][3] * c[3]) * inv,
+            ( m[3][1] * s[5] - m[3][2] * s[4] + m[3][3] * s[3]) * inv,
+            (-m[2][1] * s[5] + m[2][2] * s[4] - m[2][3] * s[3]) * inv,
+            (-m[1][0] * c[5] + m[1][2] * c[2] - m[1][3] * c[1]) * inv,
+            ( m[0][0] * c[5] - m[0][2] * c[2] + m[0][3] * c[1]) * inv,
+            (-m[3][0] * s[5] + m[3][2] * s[2] - m[3][3] * s[1]) * inv,
+            ( m[2][0] * s[5] - m[2][2] * s[2] + m[2][3] * s[1]) * inv,
+            ( m[1][0] * c[4] - m[1][1] * c[2] + m[1][3] * c[0]) * inv,
+            (-m[0][0] * c[4] + m[0][1] * c[2] - m[0][3] * c[0]) * inv,
+            ( m[3][0] * s[4] - m[3][1] * s[2] + m[3][3] * s[0]) * inv,
+            (-m[2][0] * s[4] + m[2][1] * s[2] - m[2][3] * s[0]) * inv,
+            (-m[1][0] * c[3] + m[1][1] * c[1] - m[1][2] * c[0]) * inv,
+            ( m[0][0] * c[3] - m[0][1] * c[1] + m[0][2] * c[0]) * inv,
+            (-m[3][0] * s[3] + m[3][1] * s[1] - m[3][2] * s[0]) * inv,
+            ( m[2][0] * s[3] - m[2][1] * s[1] + m[2][2] * s[0]) * inv};
+}
+
+#ifdef JC_SIMD_SSE
+inline Mat4 Mat4::_mul_simd(const Mat4 &a, const Mat4 &b) {
+    Mat4 c;
+    __m128 b0 = _mm_load_ps(b.m[0]), b1 = _mm_load_ps(b.m[1]);
+    __m128 b2 = _mm_load_ps(b.m[2]), b3 = _mm_load_ps(b.m[3]);
+    for (int i = 0; i < 4; ++i) {
+        __m128 r = _mm_mul_ps(_mm_set1_ps(a.m[i][0]), b0);
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.m[i][1]), b1));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.m[i][2]), b2));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.m[i][3]), b3));
+        _mm_store_ps(c.m[i], r);
+    }
+    return c;
+}
+
+inline Mat4 Mat4::_transpose_simd(const Mat4 &a) {
+    __m128 r0 = _mm_load_ps(a.m[0]), r1 = _mm_load_ps(a.m[1]);
+    __m128 r2 = _mm_load_ps(a.m[2]), r3 = _mm_load_ps(a.m[3]);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    Mat4 t;
+    _mm_store_ps(t.m[0], r0);
+    _mm_store_ps(t.m[1], r1);
+    _mm_store_ps(t.m[2], r2);
+    _mm_store_ps(t.m[3], r3);
+    return t;
+}
+
+// M * v is the sum of M's columns scaled by v, the columns are the rows of M^T.
+inline Vec4 Mat4::_transform_simd(const Mat4 &a, const Vec4 &v) {
+    __m128 c0 = _mm_load_ps(a.m[0]), c1 = _mm_load_ps(a.m[1]);
+    __m128 c2 = _mm_load_ps(a.m[2]), c3 = _mm_load_ps(a.m[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    __m128 r = _mm_mul_ps(_mm_set1_ps(v.x), c0);
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v.y), c1));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v.z), c2));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v.w), c3));
+    Vec4 out;
+    _mm_store_ps(&out.x, r);
+    return out;
+}
+
+#define _JC_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define _JC_SWIZZLE(a, x, y, z, w) _JC_SHUFFLE(a, a, x, y, z, w)
+
+// 2x2 blocks packed as (m00, m01, m10, m11): A * B, adj(A) * B, A * adj(B).
+inline __m128 _jcMat2Mul(__m128 a, __m128 b) {
+    return _mm_add_ps(_mm_mul_ps(a, _JC_SWIZZLE(b, 0, 3, 0, 3)),
+                      _mm_mul_ps(_JC_SWIZZLE(a, 1, 0, 3, 2), _JC_SWIZZLE(b, 2, 1, 2, 1)));
+}
+inline __m128 _jcMat2AdjMul(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(_JC_SWIZZLE(a, 3, 3, 0, 0), b),
+                      _mm_mul_ps(_JC_SWIZZLE(a, 1, 1, 2, 2), _JC_SWIZZLE(b, 2, 3, 0, 1)));
+}
+inline __m128 _jcMat2MulAdj(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(a, _JC_SWIZZLE(b, 3, 0, 3, 0)),
+                      _mm_mul_ps(_JC_SWIZZLE(a, 1, 0, 3, 2), _JC_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// Block inverse of M = [A B; C D] on 2x2 blocks.
+inline Mat4 Mat4::_inverse_simd(const Mat4 &a) {
+    __m128 r0 = _mm_load_ps(a.m[0]), r1 = _mm_load_ps(a.m[1]);
+    __m128 r2 = _mm_load_ps(a.m[2]), r3 = _mm_load_ps(a.m[3]);
+    __m128 A = _mm_movelh_ps(r0, r1), B = _mm_movehl_ps(r1, r0);
+    __m128 C = _mm_movelh_ps(r2, r3), D = _mm_movehl_ps(r3, r2);
+
+    // (|A|, |B|, |C|, |D|)
+    __m128 det_sub = _mm_sub_ps(
+        _mm_mul_ps(_JC_SHUFFLE(r0, r2, 0, 2, 0, 2), _JC_SHUFFLE(r1, r3, 1, 3, 1, 3)),
+        _mm_mul_ps(_JC_SHUFFLE(r0, r2, 1, 3, 1, 3), _JC_SHUFFLE(r1, r3, 0, 2, 0, 2)));
+    __m128 det_a = _JC_SWIZZLE(det_sub, 0, 0, 0, 0), det_b = _JC_SWIZZLE(det_sub, 1, 1, 1, 1);
+    __m128 det_c = _JC_SWIZZLE(det_sub, 2, 2, 2, 2), det_d = _JC_SWIZZLE(det_sub, 3, 3, 3, 3);
+
+    __m128 d_c = _jcMat2AdjMul(D, C);
+    __m128 a_b = _jcMat2AdjMul(A, B);
+    __m128 x = _mm_sub_ps(_mm_mul_ps(det_d, A), _jcMat2Mul(B, d_c));
+    __m128 w = _mm_sub_ps(_mm_mul_ps(det_a, D), _jcMat2Mul(C, a_b));
+    __m128 y = _mm_sub_ps(_mm_mul_ps(det_b, C), _jcMat2MulAdj(D, a_b));
+    __m128 z = _mm_sub_ps(_mm_mul_ps(det_c, B), _jcMat2MulAdj(A, d_c));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+    __m128 tr = _mm_mul_ps(a_b, _JC_SWIZZLE(d_c, 0, 2, 1, 3));
+    tr = _mm_add_ps(tr, _JC_SWIZZLE(tr, 2, 3, 0, 1));
+    tr = _mm_add_ps(tr, _JC_SWIZZLE(tr, 1, 0, 3, 2));
+    __m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), tr);
+    __m128 rdet = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), det);
+
+    x = _mm_mul_ps(x, rdet);
+    y = _mm_mul_ps(y, rdet);
+    z = _mm_mul_ps(z, rdet);
+    w = _mm_mul_ps(w, rdet);
+
+    Mat4 inv;
+    _mm_store_ps(inv.m[0], _JC_SHUFFLE(x, y, 3, 1, 3, 1));
+    _mm_store_ps(inv.m[1], _JC_SHUFFLE(x, y, 2, 0, 2, 0));
+    _mm_store_ps(inv.m[2], _JC_SHUFFLE(z, w, 3, 1, 3, 1));
+    _mm_store_ps(inv.m[3], _JC_SHUFFLE(z, w, 2, 0, 2, 0));
+    return inv;
+}
+
+#undef _JC_SWIZZLE
+#undef _JC_SHUFFLE
+#endif // JC_SIMD_SSE
+
+// out[i] = M * in[i]; in and out may be the same array.
+inline void transformBatch(const Mat4 &a, const Vec4 *in, Vec4 *out, size_t n) {
+    size_t i = 0;
+    #ifdef JC_SIMD_SSE
+    __m128 c0 = _mm_load_ps(a.m[0]), c1 = _mm_load_ps(a.m[1]);
+    __m128 c2 = _mm_load_ps(a.m[2]), c3 = _mm_load_ps(a.m[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    #ifdef JC_SIMD_AVX
+    __m256 w0 = _mm256_set_m128(c0, c0), w1 = _mm256_set_m128(c1, c1);
+    __m256 w2 = _mm256_set_m128(c2, c2), w3 = _mm256_set_m128(c3, c3);
+    for (; i + 2 <= n; i += 2) {
+        __m256 v = _mm256_loadu_ps(&in[i].x);
+        __m256 r = _mm256_mul_ps(_mm256_shuffle_ps(v, v, 0x00), w0);
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(v, v, 0x55), w1));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(v, v, 0xaa), w2));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(v, v, 0xff), w3));
+        _mm256_storeu_ps(&out[i].x, r);
+    }
+    #endif
+    for (; i < n; ++i) {
+        __m128 v = _mm_load_ps(&in[i].x);
+        __m128 r = _mm_mul_ps(_mm_shuffle_ps(v, v, 0x00), c0);
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0x55), c1));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xaa), c2));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xff), c3));
+        _mm_store_ps(&out[i].x, r);
+    }
+    #endif
+    for (; i < n; ++i) out[i] = Mat4::_transform_scalar(a, in[i]);
+}
+
+// Blocking of the large Matrix<T> product: B is packed KC x NC at a time into
+// NR-wide strips, A in MC-row panels of MR-tall strips, and a micro-kernel
+// computes one MR x NR tile of C from a strip of each.
+#ifdef JC_SIMD_AVX
+#define JC_GEMM_MR 8
+#else
+#define JC_GEMM_MR 4
+#endif
+#define JC_GEMM_NR 8
+#define JC_GEMM_KC 256
+#define JC_GEMM_MC 96
+#define JC_GEMM_NC 1024
+// Multiply-adds from which the blocked and then the parallel path are taken.
+#define JC_GEMM_BLOCKED_MIN (32 * 32 * 32)
+#define JC_GEMM_PARALLEL_MIN (128 * 128 * 128)
+
+// Pool the large products split their row panels over, nullptr keeps them on
+// the calling thread. JCEntry points it at its workers.
+inline JCWorkerPool *JCMathPool = nullptr;
+
+template<typename T> class Matrix;
+template<typename T, typename L, typename R> struct MatrixProduct;
+template<typename T, typename L, typename R, typename Op> struct MatrixCwise;
+struct _JCMatrixAdd;
+
+// Base of Matrix and of the lazy expressions built from it (see MatrixCwise).
+// Every node has rows(), cols(), _elem(k) for the k-th element in row-major
+// order, _prepare() run once before the elements are read, and _reads(p)
+// telling whether the matrix p is one of its operands.
+template<typename T, typename E>
+struct MatrixExpr {
+    const E& _self() const { return static_cast<const E&>(*this); }
+};
+
+template<typename E> struct _JCIsProduct : std::false_type {};
+template<typename T, typename L, typename R>
+struct _JCIsProduct<MatrixProduct<T, L, R>> : std::true_type {};
+template<typename E> struct _JCIsSum : std::false_type {};
+template<typename T, typename L, typename R>
+struct _JCIsSum<MatrixCwise<T, L, R, _JCMatrixAdd>> : std::true_type {};
 
 template<typename T>
-class Matrix {
+class Matrix : public MatrixExpr<T, Matrix<T>> {
 public:
     int n, m;
     std::vector<T> M;
@@ -20,41 +499,55 @@ public:
             std::copy(V[i].begin(), V[i].end(), M.begin() + i * m);
     }
 
+    // Evaluates an expression in one pass, e.g. Matrix<T> C = A * B + D.
+    template<typename E>
+    Matrix(const MatrixExpr<T, E> &e) : n(0), m(0) {
+        _assign(e._self());
+    }
+
+    template<typename E>
+    Matrix<T>& operator= (const MatrixExpr<T, E> &e) {
+        return _assign(e._self());
+    }
+
     const T& at(int x, int y) const { return M[x * m + y]; }
     T& at(int x, int y) { return M[x * m + y]; }
 
-    Matrix<T> operator* (const Matrix &B) const {
-        if (m != B.n) throw "Matrix Size Not Match!";
-        Matrix<T> C(n, B.m);
-        for (int i = 0; i < n; ++i)
-            for (int j = 0; j < m; ++j)
-                for (int k = 0; k < B.m; ++k)
-                    C.at(i, k) += at(i, j) * B.at(j, k);
-        return C;
-    }
+    int rows() const { return n; }
+    int cols() const { return m; }
+    T _elem(size_t k) const { return M[k]; }
+    void _prepare() const {}
+    bool _reads(const Matrix *p) const { return p == this; }
 
-    Matrix<T> operator+ (const Matrix &B) const {
-        if (n != B.n || m != B.m) throw "Matrix Size Not Match!";
-        Matrix<T> C(n, m);
-        for (int i = 0, s = n * m; i < s; ++i)
-            C.M[i] = M[i] + B.M[i];
-        return C;
-    }
+    // C = A * B, reusing C's buffer when it is big enough.
+    static void multiply(const Matrix &A, const Matrix &B, Matrix &C);
 
-    Matrix<T>& operator*= (const Matrix &A) {
-        Matrix<T> C = *this * A;
-        n = C.n, m = C.m;
-        swap(M, C.M);
-        return *this;
-    }
+    static void _gemm(const Matrix &A, const Matrix &B, T *c);
+    static void _gemm_simple(const T *a, const T *b, T *c, int n, int m, int p);
+    static void _gemm_blocked(const T *a, const T *b, T *c, int n, int m, int p, JCWorkerPool *pool);
+    static void _pack_a(const T *a, int lda, int mc, int kc, T *out);
+    static void _pack_b(const T *b, int ldb, int kc, int nc, T *out);
+    static void _micro(int kc, const T *a, const T *b, T *tile);
+
+    template<typename E>
+    Matrix<T>& operator*= (const MatrixExpr<T, E> &e);
 
-    Matrix<T>& operator+= (const Matrix &A) {
-        if (A.n != n || A.m != m) throw "Matrix Size Not Match!";
-        for (int i = 0, n = A.n * A.m; i < n; ++i)
-            M[i] += A.M[i];
+    Matrix<T>& operator*= (T k) {
+        for (T &x : M) x *= k;
         return *this;
     }
 
+    template<typename E>
+    Matrix<T>& operator+= (const MatrixExpr<T, E> &e);
+
+    template<typename E>
+    Matrix<T>& operator-= (const MatrixExpr<T, E> &e);
+
+    template<typename E>
+    Matrix<T>& _assign(const E &e);
+    template<typename E>
+    Matrix<T>& _assign_elements(const E &e);
+
     friend std::ostream& operator<<(std::ostream &os, const Matrix &A) {
         os << "{";
         for (int i = 0; i < A.n; ++i) {
@@ -67,4 +560,594 @@ public:
     }
 };
 
+template<typename T>
+void Matrix<T>::multiply(const Matrix &A, const Matrix &B, Matrix &C) {
+    if (A.m != B.n) throw "Matrix Size Not Match!";
+    if (&C == &A || &C == &B) {
+        Matrix<T> D(0, 0);
+        multiply(A, B, D);
+        C = std::move(D);
+        return;
+    }
+    C.n = A.n, C.m = B.m;
+    C.M.assign((size_t)C.n * C.m, T());
+    _gemm(A, B, C.M.data());
+}
+
+// c += A * B, c holds A.n x B.m elements and is neither A nor B.
+template<typename T>
+void Matrix<T>::_gemm(const Matrix &A, const Matrix &B, T *c) {
+    int64_t work = (int64_t)A.n * A.m * B.m;
+    // Too thin for tiles, e.g. matrix-vector: packing would cost more than it saves.
+    bool thin = A.n < JC_GEMM_MR || B.m < JC_GEMM_NR;
+    if (work < JC_GEMM_BLOCKED_MIN || thin) _gemm_simple(A.M.data(), B.M.data(), c, A.n, A.m, B.m);
+    else _gemm_blocked(A.M.data(), B.M.data(), c, A.n, A.m, B.m,
+        work >= JC_GEMM_PARALLEL_MIN ? JCMathPool : nullptr);
+}
+
+template<typename T>
+void Matrix<T>::_gemm_simple(const T *a, const T *b, T *c, int n, int m, int p) {
+    if (p == 1) {
+        // Matrix-vector: dot products on four partial sums, c could alias nothing
+        // the compiler knows of, so it would store c[i] every step otherwise.
+        for (int i = 0; i < n; ++i) {
+            const T *ai = a + (size_t)i * m;
+            T s0 = T(), s1 = T(), s2 = T(), s3 = T();
+            int k = 0;
+            for (; k + 4 <= m; k += 4) {
+                s0 += ai[k] * b[k], s1 += ai[k + 1] * b[k + 1];
+                s2 += ai[k + 2] * b[k + 2], s3 += ai[k + 3] * b[k + 3];
+            }
+            for (; k < m; ++k) s0 += ai[k] * b[k];
+            c[i] += (s0 + s1) + (s2 + s3);
+        }
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        T *ci = c + (size_t)i * p;
+        for (int k = 0; k < m; ++k) {
+            T aik = a[(size_t)i * m + k];
+            const T *bk = b + (size_t)k * p;
+            for (int j = 0; j < p; ++j) ci[j] += aik * bk[j];
+        }
+    }
+}
+
+// Strip ir of the panel holds rows [ir, ir + MR) column by column, zero padded.
+template<typename T>
+void Matrix<T>::_pack_a(const T *a, int lda, int mc, int kc, T *out) {
+    for (int ir = 0; ir < mc; ir += JC_GEMM_MR)
+        for (int k = 0; k < kc; ++k)
+            for (int r = 0; r < JC_GEMM_MR; ++r)
+                *out++ = ir + r < mc ? a[(size_t)(ir + r) * lda + k] : T();
+}
+
+// Strip jr holds columns [jr, jr + NR) row by row, zero padded.
+template<typename T>
+void Matrix<T>::_pack_b(const T *b, int ldb, int kc, int nc, T *out) {
+    for (int jr = 0; jr < nc; jr += JC_GEMM_NR)
+        for (int k = 0; k < kc; ++k)
+            for (int q = 0; q < JC_GEMM_NR; ++q)
+                *out++ = jr + q < nc ? b[(size_t)k * ldb + jr + q] : T();
+}
+
+template<typename T>
+void Matrix<T>::_micro(int kc, const T *a, const T *b, T *tile) {
+    T acc[JC_GEMM_MR * JC_GEMM_NR];
+    std::fill(acc, acc + JC_GEMM_MR * JC_GEMM_NR, T());
+    for (int k = 0; k < kc; ++k, a += JC_GEMM_MR, b += JC_GEMM_NR)
+        for (int r = 0; r < JC_GEMM_MR; ++r)
+            for (int q = 0; q < JC_GEMM_NR; ++q)
+                acc[r * JC_GEMM_NR + q] += a[r] * b[q];
+    std::copy(acc, acc + JC_GEMM_MR * JC_GEMM_NR, tile);
+}
+
+#ifdef JC_SIMD_SSE
+template<>
+inline void Matrix<float>::_micro(int kc, const float *a, const float *b, float *tile) {
+    #ifdef JC_SIMD_AVX
+    __m256 c0 = _mm256_setzero_ps(), c1 = c0, c2 = c0, c3 = c0, c4 = c0, c5 = c0, c6 = c0, c7 = c0;
+    for (int k = 0; k < kc; ++k, a += 8, b += 8) {
+        __m256 bk = _mm256_loadu_ps(b);
+        #ifdef __FMA__
+        #define _JC_GEMM_ROW(c, r) c = _mm256_fmadd_ps(_mm256_broadcast_ss(a + r), bk, c)
+        #else
+        #define _JC_GEMM_ROW(c, r) c = _mm256_add_ps(c, _mm256_mul_ps(_mm256_broadcast_ss(a + r), bk))
+        #endif
+        _JC_GEMM_ROW(c0, 0); _JC_GEMM_ROW(c1, 1); _JC_GEMM_ROW(c2, 2); _JC_GEMM_ROW(c3, 3);
+        _JC_GEMM_ROW(c4, 4); _JC_GEMM_ROW(c5, 5); _JC_GEMM_ROW(c6, 6); _JC_GEMM_ROW(c7, 7);
+        #undef _JC_GEMM_ROW
+    }
+    _mm256_storeu_ps(tile, c0);      _mm256_storeu_ps(tile + 8, c1);
+    _mm256_storeu_ps(tile + 16, c2); _mm256_storeu_ps(tile + 24, c3);
+    _mm256_storeu_ps(tile + 32, c4); _mm256_storeu_ps(tile + 40, c5);
+    _mm256_storeu_ps(tile + 48, c6); _mm256_storeu_ps(tile + 56, c7);
+    #else
+    __m128 c00 = _mm_setzero_ps(), c01 = c00, c10 = c00, c11 = c00;
+    __m128 c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+    for (int k = 0; k < kc; ++k, a += 4, b += 8) {
+        __m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + 4);
+        __m128 ar = _mm_set1_ps(a[0]);
+        c00 = _mm_add_ps(c00, _mm_mul_ps(ar, b0)); c01 = _mm_add_ps(c01, _mm_mul_ps(ar, b1));
+        ar = _mm_set1_ps(a[1]);
+        c10 = _mm_add_ps(c10, _mm_mul_ps(ar, b0)); c11 = _mm_add_ps(c11, _mm_mul_ps(ar, b1));
+        ar = _mm_set1_ps(a[2]);
+        c20 = _mm_add_ps(c20, _mm_mul_ps(ar, b0)); c21 = _mm_add_ps(c21, _mm_mul_ps(ar, b1));
+        ar = _mm_set1_ps(a[3]);
+        c30 = _mm_add_ps(c30, _mm_mul_ps(ar, b0)); c31 = _mm_add_ps(c31, _mm_mul_ps(ar, b1));
+    }
+    _mm_storeu_ps(tile, c00);      _mm_storeu_ps(tile + 4, c01);
+    _mm_storeu_ps(tile + 8, c10);  _mm_storeu_ps(tile + 12, c11);
+    _mm_storeu_ps(tile + 16, c20); _mm_storeu_ps(tile + 20, c21);
+    _mm_storeu_ps(tile + 24, c30); _mm_storeu_ps(tile + 28, c31);
+    #endif
+}
+#endif // JC_SIMD_SSE
+
+// With a pool the row panels shrink so every thread gets a few of them; each
+// panel owns its rows of C, so they never write the same memory.
+template<typename T>
+void Matrix<T>::_gemm_blocked(const T *a, const T *b, T *c, int n, int m, int p, JCWorkerPool *pool) {
+    const int MR = JC_GEMM_MR, NR = JC_GEMM_NR;
+    int mc_step = JC_GEMM_MC;
+    if (pool != nullptr) {
+        int want = 4 * (pool->_thread_count + 1);
+        mc_step = std::min(mc_step, std::max(MR, ((n + want - 1) / want + MR - 1) / MR * MR));
+    }
+    int panels = (n + mc_step - 1) / mc_step;
+
+    std::vector<T> bpack;
+    for (int jc = 0; jc < p; jc += JC_GEMM_NC) {
+        int nc = std::min(JC_GEMM_NC, p - jc);
+        for (int pc = 0; pc < m; pc += JC_GEMM_KC) {
+            int kc = std::min(JC_GEMM_KC, m - pc);
+            bpack.resize((size_t)kc * ((nc + NR - 1) / NR * NR));
+            _pack_b(b + (size_t)pc * p + jc, p, kc, nc, bpack.data());
+
+            auto panel = [&](size_t index) {
+                int ic = (int)index * mc_step, mc = std::min(mc_step, n - ic);
+                thread_local std::vector<T> apack;
+                apack.resize((size_t)kc * ((mc + MR - 1) / MR * MR));
+                _pack_a(a + (size_t)ic * m + pc, m, mc, kc, apack.data());
+                T tile[JC_GEMM_MR * JC_GEMM_NR];
+                for (int jr = 0; jr < nc; jr += NR)
+                    for (int ir = 0; ir < mc; ir += MR) {
+                        _micro(kc, apack.data() + (size_t)ir * kc, bpack.data() + (size_t)jr * kc, tile);
+                        int mr = std::min(MR, mc - ir), nr = std::min(NR, nc - jr);
+                        T *cb = c + (size_t)(ic + ir) * p + jc + jr;
+                        for (int r = 0; r < mr; ++r)
+                            for (int q = 0; q < nr; ++q)
+                                cb[(size_t)r * p + q] += tile[r * NR + q];
+                    }
+            };
+            if (pool != nullptr && panels > 1) pool->parallelFor(panels, panel);
+            else for (int i = 0; i < panels; ++i) panel(i);
+        }
+    }
+}
+
+// Matrix operands are held by reference, nested expressions by value, so an
+// expression stays valid for the statement that builds it.
+template<typename T, typename E>
+using _JCOperand = typename std::conditional<std::is_same<E, Matrix<T>>::value, const Matrix<T>&, const E>::type;
+
+struct _JCMatrixAdd { template<typename T> T operator()(T a, T b) const { return a + b; } };
+struct _JCMatrixSub { template<typename T> T operator()(T a, T b) const { return a - b; } };
+struct _JCMatrixMul { template<typename T> T operator()(T a, T b) const { return a * b; } };
+struct _JCMatrixDiv { template<typename T> T operator()(T a, T b) const { return a / b; } };
+
+// Element-wise l op r, fused into the loop of whoever evaluates it.
+template<typename T, typename L, typename R, typename Op>
+struct MatrixCwise : MatrixExpr<T, MatrixCwise<T, L, R, Op>> {
+    using left_type = L;
+    using right_type = R;
+    _JCOperand<T, L> l;
+    _JCOperand<T, R> r;
+
+    MatrixCwise(const L &l, const R &r) : l(l), r(r) {
+        if (l.rows() != r.rows() || l.cols() != r.cols()) throw "Matrix Size Not Match!";
+    }
+
+    int rows() const { return l.rows(); }
+    int cols() const { return l.cols(); }
+    T _elem(size_t k) const { return Op()(l._elem(k), r._elem(k)); }
+    void _prepare() const { l._prepare(), r._prepare(); }
+    bool _reads(const Matrix<T> *p) const { return l._reads(p) || r._reads(p); }
+};
+
+// Every element of e op k, multiplied unless Op says otherwise.
+template<typename T, typename E, typename Op = _JCMatrixMul>
+struct MatrixScaled : MatrixExpr<T, MatrixScaled<T, E, Op>> {
+    _JCOperand<T, E> e;
+    T k;
+
+    MatrixScaled(const E &e, T k) : e(e), k(k) {}
+
+    int rows() const { return e.rows(); }
+    int cols() const { return e.cols(); }
+    T _elem(size_t i) const { return Op()(e._elem(i), k); }
+    void _prepare() const { e._prepare(); }
+    bool _reads(const Matrix<T> *p) const { return e._reads(p); }
+};
+
+// l * r with at least one expression operand (Matrix * Matrix is eager, see
+// operator*). Not element-wise: assigned (or added) to a matrix it runs the GEMM
+// straight into it, inside a bigger expression it is computed once by _prepare.
+template<typename T, typename L, typename R>
+struct MatrixProduct : MatrixExpr<T, MatrixProduct<T, L, R>> {
+    _JCOperand<T, L> l;
+    _JCOperand<T, R> r;
+    mutable Matrix<T> _result;
+
+    MatrixProduct(const L &l, const R &r) : l(l), r(r), _result(0, 0) {
+        if (l.cols() != r.rows()) throw "Matrix Size Not Match!";
+    }
+
+    int rows() const { return l.rows(); }
+    int cols() const { return r.cols(); }
+    T _elem(size_t k) const { return _result.M[k]; }
+    void _prepare() const { _eval(_result, false); }
+    bool _reads(const Matrix<T> *p) const { return l._reads(p) || r._reads(p); }
+
+    static const Matrix<T>& _materialize(const Matrix<T> &e, Matrix<T> &) { return e; }
+    template<typename E>
+    static const Matrix<T>& _materialize(const E &e, Matrix<T> &tmp) { return tmp = e; }
+
+    // dst = l * r, or dst += l * r when accumulating (dst already has the
+    // shape and is no operand, the caller checks both).
+    void _eval(Matrix<T> &dst, bool accumulate) const {
+        Matrix<T> lt(0, 0), rt(0, 0);
+        const Matrix<T> &a = _materialize(l, lt), &b = _materialize(r, rt);
+        if (accumulate) Matrix<T>::_gemm(a, b, dst.M.data());
+        else Matrix<T>::multiply(a, b, dst);
+    }
+};
+
+template<typename T, typename L, typename R>
+MatrixCwise<T, L, R, _JCMatrixAdd> operator+ (const MatrixExpr<T, L> &l, const MatrixExpr<T, R> &r) {
+    return {l._self(), r._self()};
+}
+
+template<typename T, typename L, typename R>
+MatrixCwise<T, L, R, _JCMatrixSub> operator- (const MatrixExpr<T, L> &l, const MatrixExpr<T, R> &r) {
+    return {l._self(), r._self()};
+}
+
+// Element-wise (Hadamard) product, operator* is the matrix product.
+template<typename T, typename L, typename R>
+MatrixCwise<T, L, R, _JCMatrixMul> hadamard(const MatrixExpr<T, L> &l, const MatrixExpr<T, R> &r) {
+    return {l._self(), r._self()};
+}
+
+// A plain product returns a Matrix like it always did, so (A * B).at(i, j),
+// auto C = A * B and the rest of the Matrix API keep working on it.
+template<typename T>
+Matrix<T> operator* (const Matrix<T> &l, const Matrix<T> &r) {
+    Matrix<T> c(0, 0);
+    Matrix<T>::multiply(l, r, c);
+    return c;
+}
+
+template<typename T, typename L, typename R>
+MatrixProduct<T, L, R> operator* (const MatrixExpr<T, L> &l, const MatrixExpr<T, R> &r) {
+    return {l._self(), r._self()};
+}
+
+template<typename T, typename E, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+MatrixScaled<T, E> operator* (const MatrixExpr<T, E> &e, S k) {
+    return {e._self(), (T)k};
+}
+
+template<typename T, typename E, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+MatrixScaled<T, E> operator* (S k, const MatrixExpr<T, E> &e) {
+    return {e._self(), (T)k};
+}
+
+// Floating point multiplies by 1 / k, integers divide every element by k.
+template<typename T, typename E, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+auto operator/ (const MatrixExpr<T, E> &e, S k) {
+    if constexpr (std::is_floating_point<T>::value) return MatrixScaled<T, E>(e._self(), T(1) / (T)k);
+    else return MatrixScaled<T, E, _JCMatrixDiv>(e._self(), (T)k);
+}
+
+template<typename T, typename E>
+MatrixScaled<T, E> operator- (const MatrixExpr<T, E> &e) {
+    return {e._self(), T(-1)};
+}
+
+template<typename T>
+template<typename E>
+Matrix<T>& Matrix<T>::_assign(const E &e) {
+    if constexpr (_JCIsProduct<E>::value) {
+        e._eval(*this, false);
+        return *this;
+    } else if constexpr (_JCIsSum<E>::value) {
+        // x + l * r: x goes into this, then the GEMM adds onto it.
+        if constexpr (_JCIsProduct<typename E::right_type>::value) {
+            if (!e.r._reads(this)) {
+                _assign(e.l);
+                e.r._eval(*this, true);
+                return *this;
+            }
+        } else if constexpr (_JCIsProduct<typename E::left_type>::value) {
+            if (!e.l._reads(this)) {
+                _assign(e.r);
+                e.l._eval(*this, true);
+                return *this;
+            }
+        }
+        return _assign_elements(e);
+    } else return _assign_elements(e);
+}
+
+// Products inside e are computed before this is resized, so e may read this.
+template<typename T>
+template<typename E>
+Matrix<T>& Matrix<T>::_assign_elements(const E &e) {
+    if ((const void *)&e == (const void *)this) return *this;
+    e._prepare();
+    n = e.rows(), m = e.cols();
+    M.resize((size_t)n * m);
+    for (size_t k = 0, s = M.size(); k < s; ++k) M[k] = e._elem(k);
+    return *this;
+}
+
+template<typename T>
+template<typename E>
+Matrix<T>& Matrix<T>::operator*= (const MatrixExpr<T, E> &e) {
+    return *this = *this * e._self();
+}
+
+template<typename T>
+template<typename E>
+Matrix<T>& Matrix<T>::operator+= (const MatrixExpr<T, E> &e) {
+    const E &x = e._self();
+    if (x.rows() != n || x.cols() != m) throw "Matrix Size Not Match!";
+    if constexpr (_JCIsProduct<E>::value) {
+        if (!x._reads(this)) {
+            x._eval(*this, true);
+            return *this;
+        }
+    }
+    x._prepare();
+    for (size_t k = 0, s = M.size(); k < s; ++k) M[k] += x._elem(k);
+    return *this;
+}
+
+template<typename T>
+template<typename E>
+Matrix<T>& Matrix<T>::operator-= (const MatrixExpr<T, E> &e) {
+    const E &x = e._self();
+    if (x.rows() != n || x.cols() != m) throw "Matrix Size Not Match!";
+    x._prepare();
+    for (size_t k = 0, s = M.size(); k < s; ++k) M[k] -= x._elem(k);
+    return *this;
+}
+
+// Non-zeros from which SpMV and sparse * dense products go parallel on JCMathPool.
+#define JC_SPARSE_PARALLEL_MIN (1 << 15)
+
+enum JCSparseLayout { JC_SPARSE_CSR, JC_SPARSE_CSC };
+
+// Compressed sparse rows (CSR) or columns (CSC). Along the major dimension
+// (rows for CSR, columns for CSC) the entries of line i are
+// values[offsets[i] .. offsets[i + 1]), indices holds their sorted minor index.
+// CSR is the one to multiply with, CSC is cheap to build column by column and
+// to multiply transposed; toCSR()/toCSC() convert in O(nnz).
+template<typename T, JCSparseLayout layout = JC_SPARSE_CSR>
+class SparseMatrix {
+public:
+    int n, m;
+    std::vector<int> offsets;
+    std::vector<int> indices;
+    std::vector<T> values;
+
+    struct triplet {
+        int row, col;
+        T value;
+    };
+
+    SparseMatrix(int n = 0, int m = 0) : n(n), m(m), offsets(_major(n, m) + 1, 0) {}
+
+    // Keeps the entries with |x| > eps.
+    explicit SparseMatrix(const Matrix<T> &A, T eps = T());
+
+    // Duplicated (row, col) entries are summed.
+    static SparseMatrix fromTriplets(int n, int m, std::vector<triplet> entries);
+
+    static int _major(int rows, int cols) { return layout == JC_SPARSE_CSR ? rows : cols; }
+    int majors() const { return _major(n, m); }
+    size_t nonZeros() const { return values.size(); }
+    size_t bytes() const {
+        return offsets.size() * sizeof(int) + indices.size() * sizeof(int) + values.size() * sizeof(T);
+    }
+
+    T get(int row, int col) const;
+    Matrix<T> dense() const;
+    SparseMatrix<T, JC_SPARSE_CSR> toCSR() const;
+    SparseMatrix<T, JC_SPARSE_CSC> toCSC() const;
+
+    // y = A x, x has m elements and y n.
+    void multiply(const T *x, T *y) const;
+    std::vector<T> operator* (const std::vector<T> &x) const;
+    Matrix<T> operator* (const Matrix<T> &B) const;
+
+    // Runs fn(begin, end) over slices of lines with about the same number of
+    // non-zeros, on JCMathPool when there are enough of them.
+    template<typename F>
+    void _for_lines(F &&fn) const;
+    SparseMatrix<T, layout == JC_SPARSE_CSR ? JC_SPARSE_CSC : JC_SPARSE_CSR> _swap_layout() const;
+};
+
+template<typename T>
+using CSRMatrix = SparseMatrix<T, JC_SPARSE_CSR>;
+template<typename T>
+using CSCMatrix = SparseMatrix<T, JC_SPARSE_CSC>;
+
+template<typename T, JCSparseLayout layout>
+SparseMatrix<T, layout>::SparseMatrix(const Matrix<T> &A, T eps) : SparseMatrix(A.n, A.m) {
+    auto keep = [eps](T x) { return eps == T() ? x != T() : (x > eps || x < -eps); };
+    for (int i = 0, lines = majors(); i < lines; ++i) {
+        for (int j = 0, len = layout == JC_SPARSE_CSR ? m : n; j < len; ++j) {
+            T x = layout == JC_SPARSE_CSR ? A.at(i, j) : A.at(j, i);
+            if (!keep(x)) continue;
+            indices.push_back(j);
+            values.push_back(x);
+        }
+        offsets[i + 1] = (int)values.size();
+    }
+}
+
+template<typename T, JCSparseLayout layout>
+SparseMatrix<T, layout> SparseMatrix<T, layout>::fromTriplets(int n, int m, std::vector<triplet> entries) {
+    auto key = [](const triplet &t) {
+        return layout == JC_SPARSE_CSR ? std::make_pair(t.row, t.col) : std::make_pair(t.col, t.row);
+    };
+    std::sort(entries.begin(), entries.end(), [&](const triplet &a, const triplet &b) { return key(a) < key(b); });
+    SparseMatrix S(n, m);
+    for (size_t k = 0; k < entries.size(); ++k) {
+        const triplet &t = entries[k];
+        if (t.row < 0 || t.row >= n || t.col < 0 || t.col >= m) throw "Matrix Index Out Of Range!";
+        auto [major, minor] = key(t);
+        if (k > 0 && key(entries[k - 1]) == key(t)) {
+            S.values.back() += t.value;
+            continue;
+        }
+        S.indices.push_back(minor);
+        S.values.push_back(t.value);
+        S.offsets[major + 1] = (int)S.values.size();
+    }
+    // Lines without entries take the end of the line before them.
+    for (int i = 1, lines = S.majors(); i <= lines; ++i)
+        S.offsets[i] = std::max(S.offsets[i], S.offsets[i - 1]);
+    return S;
+}
+
+template<typename T, JCSparseLayout layout>
+T SparseMatrix<T, layout>::get(int row, int col) const {
+    int major = layout == JC_SPARSE_CSR ? row : col, minor = layout == JC_SPARSE_CSR ? col : row;
+    auto begin = indices.begin() + offsets[major], end = indices.begin() + offsets[major + 1];
+    auto it = std::lower_bound(begin, end, minor);
+    return it != end && *it == minor ? values[it - indices.begin()] : T();
+}
+
+template<typename T, JCSparseLayout layout>
+Matrix<T> SparseMatrix<T, layout>::dense() const {
+    Matrix<T> A(n, m);
+    for (int i = 0, lines = majors(); i < lines; ++i)
+        for (int k = offsets[i]; k < offsets[i + 1]; ++k) {
+            if (layout == JC_SPARSE_CSR) A.at(i, indices[k]) = values[k];
+            else A.at(indices[k], i) = values[k];
+        }
+    return A;
+}
+
+// Counting sort by minor index; walking the lines in order keeps every new
+// line's indices sorted.
+template<typename T, JCSparseLayout layout>
+SparseMatrix<T, layout == JC_SPARSE_CSR ? JC_SPARSE_CSC : JC_SPARSE_CSR> SparseMatrix<T, layout>::_swap_layout() const {
+    SparseMatrix<T, layout == JC_SPARSE_CSR ? JC_SPARSE_CSC : JC_SPARSE_CSR> S(n, m);
+    S.indices.resize(indices.size());
+    S.values.resize(values.size());
+    for (int minor : indices) S.offsets[minor + 1] += 1;
+    for (size_t i = 1; i < S.offsets.size(); ++i) S.offsets[i] += S.offsets[i - 1];
+    std::vector<int> next(S.offsets.begin(), S.offsets.end() - 1);
+    for (int i = 0, lines = majors(); i < lines; ++i)
+        for (int k = offsets[i]; k < offsets[i + 1]; ++k) {
+            int to = next[indices[k]]++;
+            S.indices[to] = i;
+            S.values[to] = values[k];
+        }
+    return S;
+}
+
+template<typename T, JCSparseLayout layout>
+SparseMatrix<T, JC_SPARSE_CSR> SparseMatrix<T, layout>::toCSR() const {
+    if constexpr (layout == JC_SPARSE_CSR) return *this;
+    else return _swap_layout();
+}
+
+template<typename T, JCSparseLayout layout>
+SparseMatrix<T, JC_SPARSE_CSC> SparseMatrix<T, layout>::toCSC() const {
+    if constexpr (layout == JC_SPARSE_CSC) return *this;
+    else return _swap_layout();
+}
+
+template<typename T, JCSparseLayout layout>
+template<typename F>
+void SparseMatrix<T, layout>::_for_lines(F &&fn) const {
+    int lines = majors();
+    JCWorkerPool *pool = JCMathPool;
+    if (pool == nullptr || pool->_thread_count == 0 || values.size() < JC_SPARSE_PARALLEL_MIN) {
+        fn(0, lines);
+        return;
+    }
+    size_t slices = 4 * (pool->_thread_count + 1), nnz = values.size();
+    auto line_at = [&](size_t slice) {
+        if (slice == slices) return lines;
+        return (int)(std::lower_bound(offsets.begin(), offsets.end(), (int)(nnz * slice / slices)) - offsets.begin());
+    };
+    pool->parallelFor(slices, [&](size_t slice) {
+        int begin = line_at(slice), end = line_at(slice + 1);
+        if (begin < end) fn(begin, end);
+    });
+}
+
+// CSR gathers a row at a time, so its slices write disjoint parts of y.
+// CSC scatters a column into all of y and stays on the calling thread.
+template<typename T, JCSparseLayout layout>
+void SparseMatrix<T, layout>::multiply(const T *x, T *y) const {
+    if constexpr (layout == JC_SPARSE_CSR) {
+        _for_lines([&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                T sum = T();
+                for (int k = offsets[i]; k < offsets[i + 1]; ++k) sum += values[k] * x[indices[k]];
+                y[i] = sum;
+            }
+        });
+    } else {
+        std::fill(y, y + n, T());
+        for (int j = 0; j < m; ++j) {
+            T xj = x[j];
+            for (int k = offsets[j]; k < offsets[j + 1]; ++k) y[indices[k]] += values[k] * xj;
+        }
+    }
+}
+
+template<typename T, JCSparseLayout layout>
+std::vector<T> SparseMatrix<T, layout>::operator* (const std::vector<T> &x) const {
+    if ((int)x.size() != m) throw "Matrix Size Not Match!";
+    std::vector<T> y(n);
+    multiply(x.data(), y.data());
+    return y;
+}
+
+template<typename T, JCSparseLayout layout>
+Matrix<T> SparseMatrix<T, layout>::operator* (const Matrix<T> &B) const {
+    if (m != B.n) throw "Matrix Size Not Match!";
+    Matrix<T> C(n, B.m);
+    int p = B.m;
+    if constexpr (layout == JC_SPARSE_CSR) {
+        _for_lines([&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                T *ci = C.M.data() + (size_t)i * p;
+                for (int k = offsets[i]; k < offsets[i + 1]; ++k) {
+                    T a = values[k];
+                    const T *bk = B.M.data() + (size_t)indices[k] * p;
+                    for (int j = 0; j < p; ++j) ci[j] += a * bk[j];
+                }
+            }
+        });
+    } else {
+        for (int col = 0; col < m; ++col) {
+            const T *bk = B.M.data() + (size_t)col * p;
+            for (int k = offsets[col]; k < offsets[col + 1]; ++k) {
+                T a = values[k], *ci = C.M.data() + (size_t)indices[k] * p;
+                for (int j = 0; j < p; ++j) ci[j] += a * bk[j];
+            }
+        }
+    }
+    return C;
+}
+
 #endif // _JCENGINE_MATH_H_
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef _JCENGINE_POOL_H_
+#define _JCENGINE_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <new>
+#include <utility>
+#include <iostream>
+
+#include <jc_base.h>
+
+// Counters of one pool; JCPoolReport sums them by subsystem name.
+struct JCPoolStats {
+    std::atomic<uint64_t> allocs{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> reserved{0};   // bytes of chunks taken from the heap
+};
+
+// Fixed-size blocks carved from chunks of `chunk_blocks`, which are only given
+// back when the pool dies, so blocks never move. Freed blocks are reused
+// through an intrusive free list. With `thread_cache` each thread keeps a few
+// blocks of its own and only takes the pool lock once per batch; such a pool
+// may die before the threads that used it, their leftovers are dropped.
+struct JCBlockPool {
+    const char *name;
+    size_t block_size;
+    size_t chunk_blocks;
+    int thread_cache;
+    uint64_t _serial;
+
+    std::mutex mtx;
+    void *_free;
+    std::vector<void *> _chunks;
+    JCPoolStats stats;
+
+    _DELETE_COPY_MOVE_(JCBlockPool)
+
+    JCBlockPool(const char *name, size_t block_size, size_t chunk_blocks = 256, int thread_cache = 0);
+    ~JCBlockPool();
+
+    void* allocate();
+    void deallocate(void *p);
+    void* _pop();                          // mtx held
+    void _push(void *p);                   // mtx held
+};
+
+template<typename T>
+struct JCObjectPool : JCBlockPool {
+    JCObjectPool(const char *name, size_t chunk_blocks = 256, int thread_cache = 0)
+        : JCBlockPool(name, sizeof(T), chunk_blocks, thread_cache) {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "JCObjectPool blocks are max_align_t aligned");
+    }
+
+    template<typename... Args>
+    T* create(Args&&... args) {
+        return new (allocate()) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T *p) {
+        p->~T();
+        deallocate(p);
+    }
+};
+
+// One line per subsystem: allocations, frees, live and reserved bytes.
+void JCPoolReport(std::ostream &out);
+
+#endif // _JCENGINE_POOL_H_
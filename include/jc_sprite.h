@@ -0,0 +1,56 @@
+#ifndef _JCENGINE_SPRITE_H_
+#define _JCENGINE_SPRITE_H_
+
+#include <vector>
+
+#include <SDL3/SDL.h>
+#include <jc_base.h>
+#include <jc_transform.h>
+#include <jc_arena.h>
+
+// Collects textured quads over a frame and draws them with one
+// SDL_RenderGeometry per run of equal (layer, texture) in flush().
+// Lower layers are drawn first; inside a layer, sprites sharing a texture
+// keep the order they were queued in, sprites of different textures are
+// grouped by texture and don't keep their relative order.
+// The buffers are kept across frames, a steady frame allocates nothing.
+// With `frame` set the vertices of a flush are taken from it instead.
+struct JCSpriteBatch {
+    struct _sprite {
+        SDL_Texture *texture;
+        int layer;
+        float angle;
+        JCRect dst;
+        JCRect src;         // pixels, w <= 0 means the whole texture
+        SDL_FColor color;
+        uint32_t seq;       // queue order, ties the sort
+    };
+
+    SDL_Renderer *ren;
+    JCFrameArena *frame = nullptr;
+    std::vector<_sprite> _queue;
+    std::vector<SDL_Vertex> _vertices;
+    std::vector<int> _indices;      // 0 1 2 2 3 0 per quad, only ever grows
+    size_t draw_calls;              // SDL_RenderGeometry calls of the last flush
+
+    _DELETE_COPY_MOVE_(JCSpriteBatch)
+
+    JCSpriteBatch(SDL_Renderer *ren = nullptr) : ren(ren), draw_calls(0) {}
+
+    // angle in degrees clockwise around the center of dst, like SDL_RenderTextureRotated.
+    void draw(SDL_Texture *texture, const JCRect &dst, int layer = 0, float angle = 0,
+        const JCRect *src = nullptr, SDL_FColor color = {1, 1, 1, 1}) {
+        _queue.push_back({texture, layer, angle, dst, src ? *src : JCRect{0, 0, 0, 0}, color,
+            (uint32_t)_queue.size()});
+    }
+
+    // Every transform's world rect and angle, all with the same texture.
+    void draw(SDL_Texture *texture, const JCTransforms &transforms, int layer = 0);
+
+    size_t size() const { return _queue.size(); }
+    void clear() { _queue.clear(); }
+    // Draws and empties the queue.
+    int flush();
+};
+
+#endif // _JCENGINE_SPRITE_H_
@@ -0,0 +1,68 @@
+#ifndef _JCENGINE_TRANSFORM_H_
+#define _JCENGINE_TRANSFORM_H_
+
+#include <vector>
+#include <cstdint>
+
+#include <jc_base.h>
+#include <jc_ds.h>
+
+// Same layout as SDL_FRect, renderers hand it straight to SDL.
+struct JCRect {
+    float x, y, w, h;
+};
+
+// Flat transforms as structure of arrays, one vector per component, so
+// updateAll streams through each of them and vectorizes. Position is the
+// top-left corner like SDL_FRect, angle is in degrees clockwise like
+// SDL_RenderTextureRotated takes it, w/h is the size before scaling.
+// Components are written in place: x[index(id)] = ...; an index stays valid
+// until the next create or erase.
+struct JCTransforms {
+    std::vector<float> x, y, vx, vy, angle, spin, sx, sy, w, h;
+    std::vector<JCRect> world;      // filled by updateAll
+    JCSlotIndex _index;
+
+    slot_id create(JCRect rect);
+    int erase(slot_id id);
+    uint32_t index(slot_id id) const { return _index.index(id); }
+    size_t size() const { return x.size(); }
+    const JCRect* rect(slot_id id) const;
+
+    // Moves everything by its velocity and spin over dt seconds, then
+    // rebuilds the world rects.
+    void updateAll(float dt);
+};
+
+// Parent/child transforms: a node's local position, angle and scale apply
+// inside its parent's world transform. setLocal, setSize and setParent mark
+// nodes dirty; updateAll visits parents before children and recomputes a node
+// when it or an ancestor is dirty, so moving a parent drags its subtree along
+// in the same pass and untouched subtrees cost one flag test per node.
+// Scale does not shear: a rotated child keeps the parent's axis scales.
+struct JCTransformTree {
+    std::vector<float> x, y, angle, sx, sy, w, h;
+    std::vector<slot_id> parent;
+    std::vector<float> wx, wy, wangle, wsx, wsy, _wcos, _wsin;
+    std::vector<JCRect> world;
+    std::vector<uint8_t> dirty;
+
+    JCSlotIndex _index;
+    std::vector<uint32_t> _order;           // dense indices, parents first
+    std::vector<uint32_t> _parent_index;    // dense index of the parent, UINT32_MAX for roots
+    int _order_dirty = 0;
+
+    slot_id create(JCRect rect, slot_id parent = JC_SLOT_INVALID);
+    int erase(slot_id id);                  // with its subtree
+    int setLocal(slot_id id, float x, float y, float angle = 0, float sx = 1, float sy = 1);
+    int setSize(slot_id id, float w, float h);
+    int setParent(slot_id id, slot_id parent);
+    uint32_t index(slot_id id) const { return _index.index(id); }
+    size_t size() const { return x.size(); }
+    const JCRect* rect(slot_id id) const;
+
+    void updateAll();
+    void _rebuild_order();
+};
+
+#endif // _JCENGINE_TRANSFORM_H_
@@ -0,0 +1,63 @@
+#ifndef _JCENGINE_WORKER_H_
+#define _JCENGINE_WORKER_H_
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <type_traits>
+
+#include <jc_base.h>
+
+struct JCWorkerTask {
+    void (*fn)(void *ctx, size_t index);
+    void *ctx;
+    size_t index;
+    std::atomic<size_t> *remaining;
+};
+
+// Work-stealing pool: every worker owns a deque, pops its own tasks from the
+// back and steals others' from the front. A thread blocked in parallelFor
+// steals too, so nested parallelFor calls from a task never deadlock.
+// Threads are started on the first parallelFor.
+struct JCWorkerPool {
+    struct _worker {
+        std::mutex mtx;
+        std::deque<JCWorkerTask> tasks;
+    };
+
+    int _thread_count;
+    std::vector<std::unique_ptr<_worker>> _workers;
+    std::vector<std::thread> _threads;
+    std::once_flag _started;
+    std::atomic<int> running_;
+    std::atomic<size_t> _queued;
+    std::atomic<size_t> _next_worker;
+    std::mutex _sleep_mtx;
+    std::condition_variable _sleep_cv;
+
+    _DELETE_COPY_MOVE_(JCWorkerPool)
+
+    // 0 threads: one less than the hardware threads, the caller works too.
+    JCWorkerPool(int threads = 0);
+    ~JCWorkerPool();
+
+    // Runs fn(i) for every i in [0, n) and returns once all of them finished.
+    template<typename F>
+    void parallelFor(size_t n, F &&fn) {
+        using fn_type = typename std::remove_reference<F>::type;
+        auto trampoline = [](void *ctx, size_t index) { (*static_cast<fn_type*>(ctx))(index); };
+        _run(n, trampoline, (void *)&fn);
+    }
+
+    void _run(size_t n, void (*fn)(void *, size_t), void *ctx);
+    void _start();
+    bool _try_run(int self);
+    void _worker_loop(int self);
+};
+
+#endif // _JCENGINE_WORKER_H_
@@ -5,6 +5,12 @@
 #include <jc_event.h>
 #include <jc_math.h>
 #include <jc_ds.h>
+#include <jc_func.h>
+#include <jc_worker.h>
+#include <jc_pool.h>
+#include <jc_arena.h>
+#include <jc_transform.h>
+#include <jc_sprite.h>
 #include <jc_entry.h>
 #include <jc_image.h>
 
@@ -0,0 +1,84 @@
+// Microbenchmark of timer register/fire and event center emit throughput.
+// Needs no SDL, build it by hand:
+//   g++ -O2 -std=c++17 -pthread -Iinclude src/bench_event.cpp src/subsys/ds.cpp src/subsys/event.cpp src/subsys/pool.cpp src/subsys/arena.cpp src/subsys/worker.cpp
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include <jc_event.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double nsPerOp(bench_clock::time_point start, int64_t ops) {
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / ops;
+}
+
+// Captures three pointers, past the 16 bytes std::function keeps in place.
+static void benchTimer(int n) {
+    std::atomic<int> fired{0};
+    int64_t sum = 0, *psum = &sum;
+    std::atomic<int> *pfired = &fired;
+
+    {
+        JCEventTimer<4096, 3> timer;
+        timer.tickless = 1;
+        timer.setTickMS(1);
+
+        auto start = bench_clock::now();
+        for (int i = 0; i < n; ++i)
+            timer.registerEvent(0, 0, [pfired, psum, i](void *) {
+                *psum += i;
+                pfired->fetch_add(1, std::memory_order_relaxed);
+                return JC_SUCCESS;
+            });
+        std::cout << "timer register        " << nsPerOp(start, n) << " ns/op\n";
+        while (fired.load() < n) std::this_thread::yield();
+        std::cout << "timer register + fire " << nsPerOp(start, n) << " ns/op\n";
+    }
+
+    {
+        // Far away timers, measures registration and teardown alone.
+        JCEventTimer<4096, 3> timer;
+        timer.setTickMS(1);
+        auto start = bench_clock::now();
+        for (int i = 0; i < n; ++i)
+            timer.registerEvent(3600 * 1000, 0, [pfired, psum, i](void *) {
+                *psum += i;
+                return JC_SUCCESS;
+            });
+        timer.setTickMS(1);
+        std::cout << "timer register + stop " << nsPerOp(start, n) << " ns/op\n";
+    }
+}
+
+static void benchCenter(int handlers, int n) {
+    JCEventCenter center;
+    int64_t sum = 0, *psum = &sum;
+    for (int i = 0; i < handlers; ++i)
+        center.registerEvent("bench.event", [psum, i, handlers](void *) {
+            *psum += i;
+            return i + 1 == handlers ? JC_SUCCESS : JC_CONTINUE;
+        });
+
+    auto start = bench_clock::now();
+    for (int i = 0; i < n; ++i) center.emitEvent("bench.event");
+    std::cout << "center emit x" << handlers << "        " << nsPerOp(start, n) << " ns/op"
+        << " (" << sum << ")\n";
+
+    start = bench_clock::now();
+    for (int i = 0; i < n; ++i) center.emitEvent("bench.event"_event);
+    std::cout << "center emit key x" << handlers << "    " << nsPerOp(start, n) << " ns/op\n";
+
+    event_id id = center.intern("bench.event");
+    start = bench_clock::now();
+    for (int i = 0; i < n; ++i) center.emitEvent(id);
+    std::cout << "center emit id x" << handlers << "     " << nsPerOp(start, n) << " ns/op\n";
+}
+
+int main() {
+    benchTimer(1 << 20);
+    benchCenter(8, 1 << 20);
+    return 0;
+}
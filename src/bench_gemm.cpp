@@ -0,0 +1,54 @@
+// GFLOP/s of Matrix<float> products: the plain loop, the blocked kernel on one
+// thread and the blocked kernel over a JCWorkerPool.
+// Needs no SDL, build it by hand (add -mavx -mfma for the AVX kernel):
+//   g++ -O2 -std=c++17 -pthread -Iinclude src/bench_gemm.cpp src/subsys/worker.cpp
+
+#include <iostream>
+#include <chrono>
+#include <random>
+
+#include <jc_math.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+// Repeats fn for at least 200ms and returns GFLOP/s of an n x m by m x p product.
+template<typename F>
+static double gflops(int n, int m, int p, F &&fn) {
+    int64_t runs = 0;
+    auto start = bench_clock::now();
+    double seconds = 0;
+    while (seconds < 0.2) {
+        fn();
+        ++runs;
+        seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+    }
+    return 2.0 * n * m * p * runs / seconds / 1e9;
+}
+
+int main() {
+    JCWorkerPool pool;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-1, 1);
+
+    std::cout << "size      simple   blocked  parallel (GFLOP/s, " << pool._thread_count + 1 << " threads)\n";
+    for (int n : {32, 64, 128, 256, 512, 1024}) {
+        Matrix<float> A(n, n), B(n, n), C(n, n);
+        for (float &x : A.M) x = dist(rng);
+        for (float &x : B.M) x = dist(rng);
+
+        double simple = gflops(n, n, n, [&] {
+            std::fill(C.M.begin(), C.M.end(), 0.0f);
+            Matrix<float>::_gemm_simple(A.M.data(), B.M.data(), C.M.data(), n, n, n);
+        });
+        double blocked = gflops(n, n, n, [&] {
+            std::fill(C.M.begin(), C.M.end(), 0.0f);
+            Matrix<float>::_gemm_blocked(A.M.data(), B.M.data(), C.M.data(), n, n, n, nullptr);
+        });
+        double parallel = gflops(n, n, n, [&] {
+            std::fill(C.M.begin(), C.M.end(), 0.0f);
+            Matrix<float>::_gemm_blocked(A.M.data(), B.M.data(), C.M.data(), n, n, n, &pool);
+        });
+        std::cout << n << "\t" << simple << "\t" << blocked << "\t" << parallel << "\n";
+    }
+    return 0;
+}
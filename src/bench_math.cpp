@@ -0,0 +1,83 @@
+// Microbenchmark of Mat4/Vec4 against Matrix<float> on 4x4 mul and transforms.
+// Needs no SDL, build it by hand (add -mavx for the AVX kernels, -DJC_NO_SIMD
+// for the scalar ones):
+//   g++ -O2 -std=c++17 -pthread -Iinclude src/bench_math.cpp src/subsys/worker.cpp
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <jc_math.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double nsPerOp(bench_clock::time_point start, int64_t ops) {
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / ops;
+}
+
+int main() {
+    const int n = 1 << 16, rounds = 20;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-1, 1);
+
+    std::vector<Mat4> mats(n);
+    std::vector<Matrix<float>> dynamic(n, Matrix<float>(4, 4));
+    for (int k = 0; k < n; ++k)
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                dynamic[k].at(i, j) = mats[k].m[i][j] = dist(rng) + (i == j) * 4;
+
+    // Independent products, like composing every node with its parent.
+    std::vector<Mat4> prods(n);
+    auto start = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (int k = 0; k < n; ++k) prods[k] = mats[k] * mats[(k + r + 1) & (n - 1)];
+    std::cout << "Mat4 mul            " << nsPerOp(start, (int64_t)n * rounds) << " ns/op\n";
+
+    start = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (int k = 0; k < n; ++k) prods[k] = Mat4::_mul_scalar(mats[k], mats[(k + r + 1) & (n - 1)]);
+    std::cout << "Mat4 mul scalar     " << nsPerOp(start, (int64_t)n * rounds) << " ns/op\n";
+
+    std::vector<Matrix<float>> dynamic_prods(n, Matrix<float>(4, 4));
+    start = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (int k = 0; k < n; ++k) dynamic_prods[k] = dynamic[k] * dynamic[(k + r + 1) & (n - 1)];
+    std::cout << "Matrix<float> mul   " << nsPerOp(start, (int64_t)n * rounds) << " ns/op\n";
+
+    start = bench_clock::now();
+    float det = 0;
+    for (const Mat4 &m : mats) det += m.inverse().m[0][0];
+    std::cout << "Mat4 inverse        " << nsPerOp(start, n) << " ns/op\n";
+
+    start = bench_clock::now();
+    for (const Mat4 &m : mats) det += Mat4::_inverse_scalar(m).m[0][0];
+    std::cout << "Mat4 inverse scalar " << nsPerOp(start, n) << " ns/op\n";
+
+    std::vector<Vec4> points(n), out(n);
+    for (Vec4 &p : points) p = Vec4(dist(rng), dist(rng), dist(rng), 1);
+
+    start = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) transformBatch(mats[r], points.data(), out.data(), n);
+    std::cout << "transformBatch      " << nsPerOp(start, (int64_t)n * rounds) << " ns/point\n";
+
+    start = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (int i = 0; i < n; ++i) out[i] = Mat4::_transform_scalar(mats[r], points[i]);
+    std::cout << "transform scalar    " << nsPerOp(start, (int64_t)n * rounds) << " ns/point\n";
+
+    Matrix<float> column(4, 1);
+    start = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (int i = 0; i < n; ++i) {
+            column.at(0, 0) = points[i].x, column.at(1, 0) = points[i].y;
+            column.at(2, 0) = points[i].z, column.at(3, 0) = points[i].w;
+            Matrix<float> p = dynamic[r] * column;
+            out[i].x = p.M[0];
+        }
+    std::cout << "Matrix<float> * col " << nsPerOp(start, (int64_t)n * rounds) << " ns/point\n";
+
+    std::cout << "(" << prods[0].m[0][0] + dynamic_prods[0].at(0, 0) + det + out[0].x << ")\n";
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Microbenchmark of JCSlotMap over 1M entities: insert, lookup, churn, iterate.
+// Checks handle reuse first and aborts on a failure, NDEBUG or not.
+// Needs no SDL, build it by hand:
+//   g++ -O2 -std=c++17 -Iinclude src/bench_slotmap.cpp src/subsys/ds.cpp
+
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <vector>
+
+#include <jc_ds.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double nsPerOp(bench_clock::time_point start, int64_t ops) {
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / ops;
+}
+
+struct Entity {
+    float x, y, vx, vy;
+};
+
+static void check(bool ok, const char *what) {
+    if (ok) return ;
+    std::cerr << "slotmap check failed: " << what << "\n";
+    std::abort();
+}
+
+// An erased handle stays dead after its slot is reused, the new one works.
+static void checkReuse() {
+    JCSlotMap<Entity> m;
+    slot_id a = m.insert({1, 0, 0, 0}), b = m.insert({2, 0, 0, 0});
+    check(m.erase(a) == JC_SUCCESS, "erase live handle");
+    check(m.erase(a) == JC_ERROR, "erase twice");
+    slot_id c = m.insert({3, 0, 0, 0});
+    check((c & 0xffffffffu) == (a & 0xffffffffu), "slot index reused");
+    check(c != a, "generation bumped");
+    check(!m.contains(a) && m.get(a) == nullptr, "old handle stale");
+    check(m.erase(a) == JC_ERROR && m.size() == 2, "old handle can't erase");
+    check(m.contains(c) && m.get(c)->x == 3, "new handle");
+    check(m.contains(b) && m.get(b)->x == 2, "untouched handle");
+    check(m.erase(c) == JC_SUCCESS && m.get(b)->x == 2 && m.size() == 1, "erase new handle");
+    check(m.handle(0) == b, "dense -> handle");
+}
+
+int main() {
+    checkReuse();
+
+    const int n = 1 << 20, rounds = 10;
+    JCSlotMap<Entity> entities;
+    std::vector<slot_id> ids(n);
+
+    auto start = bench_clock::now();
+    for (int i = 0; i < n; ++i) ids[i] = entities.insert({(float)i, 0, 1, 1});
+    std::cout << "insert   " << nsPerOp(start, n) << " ns/op\n";
+
+    std::vector<slot_id> shuffled = ids;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+    double sum = 0;
+    start = bench_clock::now();
+    for (slot_id id : shuffled) sum += entities.get(id)->x;
+    std::cout << "get      " << nsPerOp(start, n) << " ns/op\n";
+
+    // Churn a third of them, the dense array stays packed.
+    start = bench_clock::now();
+    for (int i = 0; i < n; i += 3) entities.erase(ids[i]);
+    for (int i = 0; i < n; i += 3) ids[i] = entities.insert({(float)i, 0, 1, 1});
+    std::cout << "churn    " << nsPerOp(start, (n + 2) / 3 * 2) << " ns/op\n";
+    for (int i = 0; i < n; ++i) check(entities.get(ids[i])->x == (float)i, "handles after churn");
+
+    start = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (Entity &e : entities) {
+            e.x += e.vx;
+            e.y += e.vy;
+        }
+    std::cout << "iterate  " << nsPerOp(start, (int64_t)n * rounds) << " ns/entity\n";
+
+    for (Entity &e : entities) sum += e.x + e.y;
+    std::cout << "(" << sum << ")\n";
+    return 0;
+}
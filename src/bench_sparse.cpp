@@ -0,0 +1,56 @@
+// Sparse vs dense Matrix<float> products at various densities: mat-vec through
+// Matrix<T>::operator* against CSR SpMV, serial and on a JCWorkerPool.
+// Needs no SDL, build it by hand:
+//   g++ -O2 -std=c++17 -pthread -Iinclude src/bench_sparse.cpp src/subsys/worker.cpp
+
+#include <iostream>
+#include <chrono>
+#include <random>
+
+#include <jc_math.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+// Repeats fn for at least 200ms and returns microseconds per call.
+template<typename F>
+static double usPerCall(F &&fn) {
+    int64_t runs = 0;
+    auto start = bench_clock::now();
+    double us = 0;
+    while (us < 2e5) {
+        fn();
+        ++runs;
+        us = std::chrono::duration<double, std::micro>(bench_clock::now() - start).count();
+    }
+    return us / runs;
+}
+
+int main() {
+    const int n = 4000;
+    JCWorkerPool pool;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-1, 1);
+
+    Matrix<float> x(n, 1), y(n, 1);
+    for (float &v : x.M) v = dist(rng);
+
+    std::cout << "density  dense(us)  csr(us)  csr parallel(us)  dense MB  csr MB\n";
+    for (double density : {0.1, 0.01, 0.001, 0.0001}) {
+        Matrix<float> A(n, n);
+        std::bernoulli_distribution nonzero(density);
+        for (float &v : A.M)
+            if (nonzero(rng)) v = dist(rng);
+        CSRMatrix<float> S(A);
+
+        JCMathPool = nullptr;
+        double dense = usPerCall([&] { y = A * x; });
+        double csr = usPerCall([&] { S.multiply(x.M.data(), y.M.data()); });
+        JCMathPool = &pool;
+        double parallel = usPerCall([&] { S.multiply(x.M.data(), y.M.data()); });
+        JCMathPool = nullptr;
+
+        std::cout << density << "\t " << dense << "\t    " << csr << "\t     " << parallel << "\t       "
+            << A.M.size() * sizeof(float) / 1e6 << "\t " << S.bytes() / 1e6 << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Milliseconds per frame of 10k-100k sprites over four textures, drawn one
+// SDL_RenderTexture each against a JCSpriteBatch flush. Renders with SDL's
+// software renderer into a surface, so it needs no window or GPU:
+//   cmake --build build --target bench_sprites
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <SDL3/SDL.h>
+#include <jc_sprite.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double msPerFrame(SDL_Renderer *ren, int frames, void (*draw)(void *), void *arg) {
+    auto start = bench_clock::now();
+    for (int f = 0; f < frames; ++f) {
+        SDL_RenderClear(ren);
+        draw(arg);
+        SDL_FlushRenderer(ren);
+    }
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count() / frames;
+}
+
+struct Scene {
+    SDL_Renderer *ren;
+    std::vector<SDL_Texture *> textures;
+    std::vector<JCRect> rects;
+    JCSpriteBatch batch;
+};
+
+int main() {
+    const int width = 1920, height = 1080, frames = 10;
+    SDL_Surface *target = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGBA8888);
+    SDL_Renderer *ren = target ? SDL_CreateSoftwareRenderer(target) : nullptr;
+    if (ren == nullptr) {
+        std::cout << "Software renderer creating failed: " << SDL_GetError() << "\n";
+        return 1;
+    }
+
+    Scene scene;
+    scene.ren = ren;
+    scene.batch.ren = ren;
+    for (Uint32 color : {0xff0000ffu, 0x00ff00ffu, 0x0000ffffu, 0xffff00ffu}) {
+        SDL_Surface *sur = SDL_CreateSurface(32, 32, SDL_PIXELFORMAT_RGBA8888);
+        SDL_FillSurfaceRect(sur, nullptr, color);
+        scene.textures.push_back(SDL_CreateTextureFromSurface(ren, sur));
+        SDL_DestroySurface(sur);
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> x(0, width - 32), y(0, height - 32);
+    std::cout << "sprites  per-sprite(ms)  batched(ms)  draw calls\n";
+    for (int n : {10000, 50000, 100000}) {
+        scene.rects.resize(n);
+        for (JCRect &r : scene.rects) r = {x(rng), y(rng), 32, 32};
+
+        double single = msPerFrame(ren, frames, [](void *arg) {
+            Scene &s = *(Scene *)arg;
+            for (size_t i = 0; i < s.rects.size(); ++i)
+                SDL_RenderTexture(s.ren, s.textures[i % s.textures.size()], NULL, (const SDL_FRect *)&s.rects[i]);
+        }, &scene);
+        double batched = msPerFrame(ren, frames, [](void *arg) {
+            Scene &s = *(Scene *)arg;
+            for (size_t i = 0; i < s.rects.size(); ++i)
+                s.batch.draw(s.textures[i % s.textures.size()], s.rects[i]);
+            s.batch.flush();
+        }, &scene);
+        std::cout << n << "\t " << single << "\t\t " << batched << "\t      " << scene.batch.draw_calls << "\n";
+    }
+
+    for (SDL_Texture *text : scene.textures) SDL_DestroyTexture(text);
+    SDL_DestroyRenderer(ren);
+    SDL_DestroySurface(target);
+    SDL_Quit();
+    return 0;
+}
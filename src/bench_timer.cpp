@@ -0,0 +1,79 @@
+// Latency of JCEventTimer::registerEvent/cancelEvent from 1 to 16 producer
+// threads, while the timer thread runs a callback that takes 5ms every tick.
+// Needs no SDL, build it by hand:
+//   g++ -O2 -std=c++17 -pthread -Iinclude src/bench_timer.cpp src/subsys/pool.cpp src/subsys/arena.cpp src/subsys/worker.cpp
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+#include <jc_event.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+struct Latencies {
+    std::vector<uint32_t> reg, cancel;   // nanoseconds per call
+};
+
+static double mean(const std::vector<uint32_t> &v) {
+    double sum = 0;
+    for (uint32_t x : v) sum += x;
+    return v.empty() ? 0 : sum / v.size();
+}
+
+static uint32_t percentile(std::vector<uint32_t> &v, double p) {
+    if (v.empty()) return 0;
+    size_t k = std::min(v.size() - 1, (size_t)(v.size() * p));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+static uint32_t nsSince(bench_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start).count();
+}
+
+int main() {
+    std::cout << "producers  ops/s      register mean/p99/max(ns)    cancel mean/p99/max(ns)\n";
+    for (int producers : {1, 2, 4, 8, 16}) {
+        JCEventTimer<4096, 3> timer;
+        timer.setTickMS(1);
+        // The slow consumer: every tick spends 5ms in a callback.
+        timer.registerEvent(0, 1, [](void *) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            return JC_SUCCESS;
+        });
+
+        std::atomic<int> go{0};
+        std::vector<Latencies> results(producers);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < producers; ++t)
+            threads.emplace_back([&timer, &go, &result = results[t]] {
+                while (!go.load()) std::this_thread::yield();
+                auto end = bench_clock::now() + std::chrono::milliseconds(500);
+                while (bench_clock::now() < end) {
+                    auto start = bench_clock::now();
+                    timer_id id = timer.registerEvent(1000, 0, [](void *) { return JC_SUCCESS; });
+                    result.reg.push_back(nsSince(start));
+                    start = bench_clock::now();
+                    timer.cancelEvent(id);
+                    result.cancel.push_back(nsSince(start));
+                }
+            });
+        go = 1;
+        for (auto &thread : threads) thread.join();
+
+        Latencies all;
+        for (auto &r : results) {
+            all.reg.insert(all.reg.end(), r.reg.begin(), r.reg.end());
+            all.cancel.insert(all.cancel.end(), r.cancel.begin(), r.cancel.end());
+        }
+        std::cout << producers << "\t   " << (int64_t)(all.reg.size() / 0.5) << "\t"
+            << (int)mean(all.reg) << " / " << percentile(all.reg, 0.99) << " / " << percentile(all.reg, 1.0)
+            << "\t\t" << (int)mean(all.cancel) << " / " << percentile(all.cancel, 0.99) << " / "
+            << percentile(all.cancel, 1.0) << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+// JCTransforms::updateAll against the per-object update it replaces: every
+// object as its own heap struct ticked through a std::function, and the
+// JCTransformTree pass with everything or a tenth of the roots dirty.
+// Needs no SDL, build it by hand:
+//   g++ -O2 -std=c++17 -pthread -Iinclude src/bench_transform.cpp src/subsys/transform.cpp src/subsys/ds.cpp
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <functional>
+
+#include <jc_transform.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+// Repeats fn for at least 200ms and returns nanoseconds per object.
+template<typename F>
+static double nsPerObject(size_t n, F &&fn) {
+    int64_t runs = 0;
+    auto start = bench_clock::now();
+    double ns = 0;
+    while (ns < 2e8) {
+        fn();
+        ++runs;
+        ns = std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+    }
+    return ns / runs / n;
+}
+
+struct Sprite {
+    float x, y, vx, vy, angle, spin, sx, sy, w, h;
+    JCRect world;
+};
+
+int main() {
+    const float dt = 1.0f / 60;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-100, 100);
+
+    std::cout << "objects   per-object(ns)  updateAll(ns)  tree all(ns)  tree 10%(ns)\n";
+    for (size_t n : {1000, 10000, 100000, 1000000}) {
+        std::vector<std::unique_ptr<Sprite>> sprites;
+        std::vector<std::function<void(float)>> updates;
+        JCTransforms flat;
+        JCTransformTree tree;
+        std::vector<slot_id> roots;
+        for (size_t i = 0; i < n; ++i) {
+            JCRect r{dist(rng), dist(rng), 32, 32};
+            float vx = dist(rng), vy = dist(rng);
+            sprites.emplace_back(new Sprite{r.x, r.y, vx, vy, 0, 10, 1, 1, r.w, r.h, r});
+            Sprite *s = sprites.back().get();
+            updates.emplace_back([s](float dt) {
+                s->x += s->vx * dt, s->y += s->vy * dt, s->angle += s->spin * dt;
+                s->world = {s->x, s->y, s->w * s->sx, s->h * s->sy};
+            });
+            uint32_t k = flat.index(flat.create(r));
+            flat.vx[k] = vx, flat.vy[k] = vy, flat.spin[k] = 10;
+            // Roots with three children each.
+            if (i % 4 == 0) roots.push_back(tree.create(r));
+            else tree.create({8, 0, 16, 16}, roots.back());
+        }
+
+        double per_object = nsPerObject(n, [&] { for (auto &update : updates) update(dt); });
+        double soa = nsPerObject(n, [&] { flat.updateAll(dt); });
+        double tree_all = nsPerObject(n, [&] {
+            for (slot_id root : roots) tree.setLocal(root, 1, 2, 3);
+            tree.updateAll();
+        });
+        double tree_some = nsPerObject(n, [&] {
+            for (size_t i = 0; i < roots.size(); i += 10) tree.setLocal(roots[i], 1, 2, 3);
+            tree.updateAll();
+        });
+        std::cout << n << "\t  " << per_object << "\t\t  " << soa << "\t\t " << tree_all << "\t       " << tree_some
+            << "   (" << sprites[0]->world.x + flat.world[0].x + tree.world[0].x << ")\n";
+    }
+    return 0;
+}
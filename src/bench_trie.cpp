@@ -0,0 +1,81 @@
+// Microbenchmark of JCTrie create/get throughput over 100k dotted keys.
+// Needs no SDL, build it by hand:
+//   g++ -O2 -mpopcnt -std=c++17 -Iinclude src/bench_trie.cpp src/subsys/ds.cpp
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <jc_ds.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double nsPerOp(bench_clock::time_point start, int64_t ops) {
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / ops;
+}
+
+// Keys shaped like event and prop names: a few shared prefixes, then random parts.
+static std::vector<std::string> makeKeys(int n) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+    static const char *prefixes[] = {"input.", "net.", "render.", "audio.", "ui.panel.", "game.ai."};
+    std::mt19937 rng(12345);
+    std::vector<std::string> keys;
+    for (int i = 0; i < n; ++i) {
+        std::string key = prefixes[rng() % 6];
+        int parts = 1 + rng() % 3;
+        for (int p = 0; p < parts; ++p) {
+            if (p) key += '.';
+            int len = 3 + rng() % 8;
+            for (int c = 0; c < len; ++c) key += alphabet[rng() % (sizeof(alphabet) - 1)];
+        }
+        keys.push_back(key);
+    }
+    return keys;
+}
+
+int main() {
+    const int n = 100000, rounds = 10;
+    std::vector<std::string> keys = makeKeys(n);
+    std::vector<std::string> shuffled = keys;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(54321));
+
+    JCTrie<int> trie;
+    auto start = bench_clock::now();
+    for (int i = 0; i < n; ++i) *trie.create(keys[i]) = i;
+    std::cout << "trie create " << nsPerOp(start, n) << " ns/op\n";
+
+    int64_t sum = 0;
+    start = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (const auto &key : shuffled) sum += *trie.get(key);
+    std::cout << "trie get    " << nsPerOp(start, (int64_t)n * rounds) << " ns/op (" << sum << ")\n";
+
+    start = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (const auto &key : shuffled) sum += trie.get(key + "x") != nullptr;
+    std::cout << "trie miss   " << nsPerOp(start, (int64_t)n * rounds) << " ns/op\n";
+
+    start = bench_clock::now();
+    JCFrozenTrie<int> frozen = trie.freeze();
+    std::cout << "freeze      " << nsPerOp(start, n) << " ns/key\n";
+
+    start = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (const auto &key : shuffled) sum += *frozen.get(key);
+    std::cout << "frozen get  " << nsPerOp(start, (int64_t)n * rounds) << " ns/op\n";
+
+    // Snapshot fed key by key, merging as the delta grows.
+    JCSnapshotTrie<int> snapshot;
+    start = bench_clock::now();
+    for (int i = 0; i < n; ++i) *snapshot.create(keys[i]) = i;
+    std::cout << "snap create " << nsPerOp(start, n) << " ns/op\n";
+
+    start = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (const auto &key : shuffled) sum += *snapshot.get(key);
+    std::cout << "snap get    " << nsPerOp(start, (int64_t)n * rounds) << " ns/op (" << sum << ")\n";
+    return 0;
+}
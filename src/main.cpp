@@ -19,6 +19,8 @@ int main(void) {
     
     int imageSize[2]; image.getSize(imageSize, imageSize + 1);
     image.setLoc({0.0, 0.0, (float)(imageSize[0] / 10.0), (float)(imageSize[1] / 10.0)});
+    slot_id sprite = image.bindTransform();
+    app.transforms.vx[app.transforms.index(sprite)] = 333.0;
 
     app.ev.registerEvent("refresh", [](void *ptr) {
             // jclog << "Render Clearing...\n";
@@ -26,11 +28,12 @@ int main(void) {
             return JC_CONTINUE;
     });
 
-    app.ev.registerEvent("refresh", [&image](void *ptr) {
+    app.ev.registerEvent("refresh", [&image, sprite](void *ptr) {
         // jclog << "Image Updating...\n";
-        int tick = SDL_GetTicks() % 2000;
-        image.location.x = tick < 1000 ? tick / 3.0 : (2000 - tick) / 3.0;
-        image.update();
+        uint32_t i = app.transforms.index(sprite);
+        float &x = app.transforms.x[i], &vx = app.transforms.vx[i];
+        if ((x < 0 && vx < 0) || (x > 333 && vx > 0)) vx = -vx;
+        image.enqueue(app.sprites);
         return JC_CONTINUE;
     });
     
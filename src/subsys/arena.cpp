@@ -0,0 +1,52 @@
+#ifndef _JCENGINE_ARENA_CPP_
+#define _JCENGINE_ARENA_CPP_
+
+#include <cstring>
+#include <algorithm>
+
+#include <jc_arena.h>
+
+JCLinearArena::JCLinearArena(size_t block_size)
+    : block_size(std::max<size_t>(block_size, 64)), _current(0), _offset(0), _used(0), _peak(0) {}
+
+JCLinearArena::~JCLinearArena() {
+    for (auto &block : _blocks) ::operator delete(block.data);
+}
+
+void JCLinearArena::_grow(size_t at_least) {
+    size_t size = std::max(block_size, at_least);
+    if (!_blocks.empty()) size = std::max(size, _blocks.back().size * 2);
+    _blocks.push_back({static_cast<char *>(::operator new(size)), size});
+    _current = _blocks.size() - 1;
+    _offset = 0;
+}
+
+void JCLinearArena::reset() {
+    _peak = std::max(_peak, _used);
+    #ifdef DEBUG
+    // Stale pointers into the last cycle now read garbage instead of old values.
+    for (size_t i = 0; i < _current; ++i)
+        std::memset(_blocks[i].data, JC_ARENA_POISON, _blocks[i].size);
+    if (!_blocks.empty()) std::memset(_blocks[_current].data, JC_ARENA_POISON, _offset);
+    #endif
+    if (_blocks.size() > 1) {
+        size_t total = reserved();
+        for (auto &block : _blocks) ::operator delete(block.data);
+        _blocks.clear();
+        _blocks.push_back({static_cast<char *>(::operator new(total)), total});
+        #ifdef DEBUG
+        std::memset(_blocks[0].data, JC_ARENA_POISON, total);
+        #endif
+    }
+    _current = 0;
+    _offset = 0;
+    _used = 0;
+}
+
+size_t JCLinearArena::reserved() const {
+    size_t total = 0;
+    for (auto &block : _blocks) total += block.size;
+    return total;
+}
+
+#endif // _JCENGINE_ARENA_CPP_
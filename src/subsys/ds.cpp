@@ -17,11 +17,35 @@ char _trie_name_chr(int x) {
     return x == 62 ? '.' : '_';
 }
 
-int countBits(int64_t x) {
-    int cnt = 0;
-    while (x) x -= x & -x, ++cnt;
-    return cnt;
+slot_id JCSlotIndex::insert() {
+    uint32_t index = _free;
+    if (index != UINT32_MAX) _free = _slots[index].dense;
+    else {
+        if (_slots.size() == UINT32_MAX) return JC_SLOT_INVALID;
+        index = _slots.size();
+        _slots.push_back({0, 1});
+    }
+    _slots[index].dense = _owner.size();
+    _owner.push_back(index);
+    return (uint64_t)_slots[index].generation << 32 | index;
 }
 
+uint32_t JCSlotIndex::erase(slot_id id) {
+    if (!contains(id)) return UINT32_MAX;
+    uint32_t index = id & 0xffffffffu;
+    uint32_t dense = _slots[index].dense, last = _owner.size() - 1;
+    if (dense != last) {
+        _owner[dense] = _owner[last];
+        _slots[_owner[dense]].dense = dense;
+    }
+    _owner.pop_back();
+
+    // Bump the generation so the old handle goes stale.
+    uint32_t generation = _slots[index].generation + 1;
+    _slots[index].generation = generation == 0 ? 1 : generation;
+    _slots[index].dense = _free;
+    _free = index;
+    return dense;
+}
 
 #endif // _JCENGINE_DS_CPP_
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define _JCENGINE_ENTRY_CPP_
 
 #include <jc_entry.h>
+#include <jc_math.h>
 #include <jc_base.h>
 #include <SDL3/SDL.h>
 
@@ -35,12 +36,22 @@ JCEntry::JCEntry(const std::string& name, int width, int height, SDL_WindowFlags
         std::terminate();
     }
 
-    ev.registerEvent("quit", [this](void *ptr) {
+    sprites.ren = render;
+    sprites.frame = &frame;
+    ev.pool = &workers;
+    ev.frame = &frame;
+    if (JCMathPool == nullptr) JCMathPool = &workers;
+    _quit_event = ev.intern("quit");
+    ev.registerEvent(_quit_event, [this](void *ptr) {
         this->quit();
         return JC_SUCCESS;
     });
 }
 
+JCEntry::~JCEntry() {
+    if (JCMathPool == &workers) JCMathPool = nullptr;
+}
+
 int JCEntry::initGPU(SDL_GPUShaderFormat format) {
     gpudev = SDL_CreateGPUDevice(format, 
     #ifdef DEBUG
@@ -58,11 +69,22 @@ int JCEntry::initGPU(SDL_GPUShaderFormat format) {
 }
 
 void JCEntry::start(int fps) {
+    // Startup registration is done, later lookups go to the frozen trie.
+    ev.trie.merge();
+    timer.tickless = 1;
     timer.setTickMS(1);
     _running = 1;
-    timer.createEvent(0, 1000 / fps, [this](void *ptr) {
+    event_id refresh = ev.intern("refresh");
+    timer.createEvent(0, 1000 / fps, [this, refresh, last = SDL_GetTicksNS()](void *ptr) mutable {
         jclog << "Timer Emit Refresh\n";
-        this->ev.emitEvent("refresh", this);
+        Uint64 now = SDL_GetTicksNS();
+        this->transforms.updateAll((now - last) / 1e9f);
+        last = now;
+        this->frame.flip();
+        // Posts of the whole frame, so coalesced events collapse to one per frame.
+        this->ev.dispatch();
+        this->ev.emitEvent(refresh, this);
+        this->sprites.flush();
         SDL_RenderPresent(this->render);
         return JC_SUCCESS;
     }, this);
@@ -75,15 +97,27 @@ void JCEntry::mainloop() {
         while (SDL_PollEvent(&ev)) {
             jclog << "Poll one event: " << ev.type << "\n";
             if (ev.type == SDL_EVENT_QUIT)
-                this->ev.emitEvent("quit", this);
+                this->ev.emitEvent(_quit_event, this);
             if (ev.type == JC_TIMER_EVENT) {
                 jclog << "Calling Timer Event !!!\n";
-                JCEventTimerCallbackData * data = (JCEventTimerCallbackData *)ev.user.data1;
-                data->callback(data->userdata);
+                auto batch = (decltype(timer)::batch_type *)ev.user.data1;
+                batch->run();
+                decltype(timer)::batchPool().destroy(batch);
             }
         }
         SDL_Delay(1);
     }
+    // Nothing pushes once the timer stops, then free the batches still queued.
+    timer.stop();
+    while (SDL_PollEvent(&ev)) {
+        if (ev.type != JC_TIMER_EVENT) continue;
+        auto batch = (decltype(timer)::batch_type *)ev.user.data1;
+        batch->drop();
+        decltype(timer)::batchPool().destroy(batch);
+    }
+    #ifdef DEBUG
+    JCPoolReport(jclog);
+    #endif
 }
 
 void JCEntry::quit() {
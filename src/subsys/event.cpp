@@ -4,39 +4,249 @@
 #include "jc_event.h"
 
 
-int JCEventTrieNode::emit(void *userdata) {
-    for (const auto & cmd : cmds) {
-        int result = cmd(userdata);
+int JCEventTrieNode::emit(void *userdata, JCWorkerPool *pool) {
+    int ret = JC_SUCCESS;
+    ++_emitting;
+    if (parallel && pool != nullptr && cmds.size() > _dead + 1) {
+        std::atomic<int> failed(0);
+        pool->parallelFor(cmds.size(), [this, userdata, &failed](size_t i) {
+            if (cmds[i].sub != UINT32_MAX && cmds[i].cmd(userdata) == JC_ERROR)
+                failed.store(1, std::memory_order_relaxed);
+        });
+        --_emitting;
+        return failed.load();
+    }
+    for (const auto & handler : cmds) {
+        if (handler.sub == UINT32_MAX) continue;
+        int result = handler.cmd(userdata);
         if (result == JC_CONTINUE) continue;
-        return result == JC_ERROR;
+        ret = result == JC_ERROR;
+        break;
     }
-    return JC_SUCCESS;
+    --_emitting;
+    return ret;
 }
     
-JCEventCenter::JCEventCenter() {
+JCEventCenter::JCEventCenter() : _ring(64), _ring_head(0), _ring_tail(0), _dispatching(0) {
+    // Slot 0 backs JC_EVENT_INVALID, so a zeroed trie value means "no event".
+    events.emplace_back();
+    names.emplace_back();
 }
     
 JCEventCenter::~JCEventCenter() {
 } 
 
-int JCEventCenter::registerEvent(const std::string &S, const cmd_type& cmd, int place) {
+event_id JCEventCenter::intern(const std::string &S) {
     checkNameValid(S);
-    JCEventTrieNode* node = trie.create(S);
-    node->cmds.push_back(cmd);
-    return JC_SUCCESS; // useless ? always success !
+    event_id *id = trie.create(S);
+    if (*id == JC_EVENT_INVALID) {
+        *id = events.size();
+        events.emplace_back();
+        names.push_back(S);
+    }
+    return *id;
 }
 
-int JCEventCenter::emitEvent(const std::string &S, void *userdata) {
+event_id JCEventCenter::intern(const JCEventKey &key) {
+    auto it = _hashed.find(key.hash);
+    if (it != _hashed.end()) {
+        const std::string &name = names[it->second];
+        if (name.size() == key.size && name.compare(0, key.size, key.name, key.size) == 0)
+            return it->second;
+        // Hash collision, the first name keeps the fast path.
+        return intern(std::string(key.name, key.size));
+    }
+    event_id id = intern(std::string(key.name, key.size));
+    _hashed.emplace(key.hash, id);
+    return id;
+}
+
+event_id JCEventCenter::_anonymous() {
+    // Reachable by id only, it never enters the trie.
+    event_id id = events.size();
+    events.emplace_back();
+    names.emplace_back();
+    return id;
+}
+
+event_id JCEventCenter::find(const std::string &S) {
     checkNameValid(S);
-    JCEventTrieNode* node = trie.get(S);
-    if (node == nullptr) return JC_ERROR;
-    return node->emit(userdata);
+    event_id *id = trie.get(S);
+    return id == nullptr ? JC_EVENT_INVALID : *id;
+}
+
+subscription_id JCEventCenter::registerEvent(const std::string &S, cmd_type cmd, int place) {
+    return registerEvent(intern(S), std::move(cmd), place);
+}
+
+subscription_id JCEventCenter::registerEvent(event_id id, cmd_type cmd, int place) {
+    if (id == JC_EVENT_INVALID || id >= events.size()) return JC_SUBSCRIPTION_INVALID;
+
+    uint32_t index = _subs_free;
+    if (index != UINT32_MAX) _subs_free = _subs[index]._free_next;
+    else {
+        index = _subs.size();
+        _subs.emplace_back();
+    }
+    _subs[index].id = id;
+
+    JCEventTrieNode &event = events[id];
+    JCEventHandler handler{std::move(cmd), place, index};
+    if (event._emitting) {
+        _subs[index].added = 1;
+        _subs[index].position = event._added.size();
+        event._added.push_back(std::move(handler));
+    } else _insert(event, std::move(handler));
+    return (uint64_t)_subs[index].generation << 32 | index;
+}
+
+void JCEventCenter::_insert(JCEventTrieNode &event, JCEventHandler handler) {
+    // After every handler of the same place, so equal places keep registration order.
+    auto key = [](int place) { return place < 0 ? INT_MAX : place; };
+    auto it = std::upper_bound(event.cmds.begin(), event.cmds.end(), key(handler.place),
+        [&key](int place, const JCEventHandler &h) { return place < key(h.place); });
+    uint32_t position = it - event.cmds.begin();
+    event.cmds.insert(it, std::move(handler));
+    for (uint32_t i = position; i < event.cmds.size(); ++i) {
+        if (event.cmds[i].sub == UINT32_MAX) continue;
+        _subs[event.cmds[i].sub].position = i;
+        _subs[event.cmds[i].sub].added = 0;
+    }
+}
+
+int JCEventCenter::unsubscribe(subscription_id sub) {
+    uint32_t index = sub & 0xffffffffu;
+    if (index >= _subs.size() || _subs[index].generation != (sub >> 32)) return JC_ERROR;
+
+    JCSubscription &s = _subs[index];
+    JCEventTrieNode &event = events[s.id];
+    // Only mark it, the callable may be the one running right now.
+    (s.added ? event._added : event.cmds)[s.position].sub = UINT32_MAX;
+    if (!s.added) event._dead += 1;
+
+    s.generation += 1;
+    if (s.generation == 0) s.generation = 1;
+    s._free_next = _subs_free;
+    _subs_free = index;
+    _settle(event);
+    return JC_SUCCESS;
+}
+
+void JCEventCenter::_settle(JCEventTrieNode &event) {
+    if (event._emitting) return;
+    for (auto &handler : event._added)
+        if (handler.sub != UINT32_MAX) _insert(event, std::move(handler));
+    event._added.clear();
+
+    // Compact once tombstones are half of the list, amortized O(1) per removal.
+    if (event._dead == 0 || event._dead * 2 < event.cmds.size()) return;
+    uint32_t live = 0;
+    for (auto &handler : event.cmds) {
+        if (handler.sub == UINT32_MAX) continue;
+        _subs[handler.sub].position = live;
+        if (&event.cmds[live] != &handler) event.cmds[live] = std::move(handler);
+        ++live;
+    }
+    event.cmds.erase(event.cmds.begin() + live, event.cmds.end());
+    event._dead = 0;
+}
+
+int JCEventCenter::emitEvent(const std::string &S, void *userdata) {
+    return emitEvent(find(S), userdata);
+}
+
+int JCEventCenter::emitEvent(const JCEventKey &key, void *userdata) {
+    return emitEvent(intern(key), userdata);
+}
+
+int JCEventCenter::emitEvent(event_id id, void *userdata) {
+    if (id == JC_EVENT_INVALID || id >= events.size()) return JC_ERROR;
+    JCEventTrieNode &event = events[id];
+    int ret = event.emit(userdata, pool);
+    if (!event._added.empty() || event._dead) _settle(event);
+    return ret;
+}
+
+int JCEventCenter::setParallel(event_id id, int parallel) {
+    if (id == JC_EVENT_INVALID || id >= events.size()) return JC_ERROR;
+    events[id].parallel = parallel;
+    return JC_SUCCESS;
+}
+
+int JCEventCenter::setCoalesce(event_id id, int coalesce) {
+    if (id == JC_EVENT_INVALID || id >= events.size()) return JC_ERROR;
+    events[id].coalesce = coalesce;
+    return JC_SUCCESS;
+}
+
+int JCEventCenter::_post(event_id id, const void *payload, uint32_t size) {
+    if (id == JC_EVENT_INVALID || id >= events.size()) return JC_ERROR;
+    JCEventTrieNode &event = events[id];
+    uint64_t mask = _ring.size() - 1;
+
+    // Still queued since the last dispatch, overwrite its payload in place.
+    if (event.coalesce && event._queued != UINT64_MAX && event._queued >= _ring_head) {
+        JCPostedEvent &posted = _ring[event._queued & mask];
+        posted.size = size;
+        if (size) std::memcpy(posted.payload, payload, size);
+        return JC_SUCCESS;
+    }
+
+    if (_ring_tail - _ring_head == _ring.size()) {
+        // Full, double it; positions stay keyed by the absolute sequence.
+        std::vector<JCPostedEvent> grown(_ring.size() * 2);
+        for (uint64_t seq = _ring_head; seq != _ring_tail; ++seq)
+            grown[seq & (grown.size() - 1)] = _ring[seq & mask];
+        _ring.swap(grown);
+        mask = _ring.size() - 1;
+    }
+
+    JCPostedEvent &posted = _ring[_ring_tail & mask];
+    posted.id = id;
+    posted.size = size;
+    if (size) std::memcpy(posted.payload, payload, size);
+    event._queued = _ring_tail++;
+    return JC_SUCCESS;
+}
+
+int JCEventCenter::dispatch() {
+    if (_dispatching) return JC_ERROR;
+    _dispatching = 1;
+
+    // Take this frame's events out of the ring, so handlers may post freely.
+    uint64_t mask = _ring.size() - 1;
+    size_t n = _ring_tail - _ring_head;
+    JCPostedEvent *batch;
+    uint64_t *order;
+    if (frame != nullptr) {
+        batch = frame->makeArray<JCPostedEvent>(n);
+        order = frame->makeArray<uint64_t>(n);
+    } else {
+        _batch.resize(n), _order.resize(n);
+        batch = _batch.data(), order = _order.data();
+    }
+    for (size_t i = 0; i < n; ++i, ++_ring_head) {
+        batch[i] = _ring[_ring_head & mask];
+        order[i] = (uint64_t)batch[i].id << 32 | i;
+    }
+
+    // Same id back to back keeps one handler list hot. The position in the low
+    // half keeps post order within an id, without stable_sort's heap buffer.
+    if (!std::is_sorted(order, order + n)) std::sort(order, order + n);
+
+    int result = JC_SUCCESS;
+    for (size_t i = 0; i < n; ++i) {
+        JCPostedEvent &posted = batch[order[i] & 0xffffffffu];
+        if (emitEvent(posted.id, posted.size ? posted.payload : nullptr) != JC_SUCCESS)
+            result = JC_ERROR;
+    }
+    _dispatching = 0;
+    return result;
 }
 
 inline void JCEventCenter::checkNameValid(const std::string &S) {
     for (char s : S) {
-        if (!('a' <= s && s <= 'z') && !('A' <= s && s <= 'Z') && !('0' <= s && s <= '9')
-            && s != '_' && s != '.')
+        if (!_event_name_valid(s))
             throw std::string("Invalid Event Name, can only contain [A-Z][a-z][0-9]._");
     }
 }
@@ -5,6 +5,7 @@
 
 JCImage::JCImage(JCEntry &entry) {
     ren = entry.render;
+    transforms = &entry.transforms;
 }
 
 int JCImage::open(const std::string& name) {
@@ -20,8 +21,23 @@ void JCImage::setLoc(SDL_FRect rect) {
     location = rect;
 }
 
+slot_id JCImage::bindTransform() {
+    if (transform == JC_SLOT_INVALID)
+        transform = transforms->create({location.x, location.y, location.w, location.h});
+    return transform;
+}
+
 bool JCImage::update() {
-    return SDL_RenderTexture(ren, text, NULL, &location);
+    uint32_t i = transform == JC_SLOT_INVALID ? UINT32_MAX : transforms->index(transform);
+    if (i == UINT32_MAX) return SDL_RenderTexture(ren, text, NULL, &location);
+    return SDL_RenderTextureRotated(ren, text, NULL, (const SDL_FRect *)&transforms->world[i],
+        transforms->angle[i], NULL, SDL_FLIP_NONE);
+}
+
+void JCImage::enqueue(JCSpriteBatch &batch, int layer) {
+    uint32_t i = transform == JC_SLOT_INVALID ? UINT32_MAX : transforms->index(transform);
+    if (i == UINT32_MAX) batch.draw(text, {location.x, location.y, location.w, location.h}, layer);
+    else batch.draw(text, transforms->world[i], layer, transforms->angle[i]);
 }
 
 void JCImage::getSize(int *w, int *h) {
@@ -0,0 +1,157 @@
+#ifndef _JCENGINE_POOL_CPP_
+#define _JCENGINE_POOL_CPP_
+
+#include <array>
+#include <map>
+#include <string>
+#include <algorithm>
+
+#include <jc_pool.h>
+
+#define JC_POOL_CACHE_BATCH 32
+#define JC_POOL_CACHE_POOLS 8
+
+// Live pools by serial, so a thread cache can tell whether its pool is still there.
+static std::mutex& poolRegistryMutex() {
+    static std::mutex mtx;
+    return mtx;
+}
+
+static std::vector<JCBlockPool *>& poolRegistry() {
+    static std::vector<JCBlockPool *> pools;
+    return pools;
+}
+
+static std::atomic<uint64_t> poolSerial(0);
+
+struct JCPoolThreadCache {
+    struct entry {
+        JCBlockPool *pool = nullptr;
+        uint64_t serial = 0;
+        std::vector<void *> blocks;
+    };
+    std::array<entry, JC_POOL_CACHE_POOLS> entries;
+
+    entry* find(JCBlockPool *pool) {
+        entry *empty = nullptr;
+        for (auto &e : entries) {
+            if (e.pool == pool && e.serial == pool->_serial) return &e;
+            // Left by a dead pool at the same address, its blocks went with it.
+            if (e.pool == pool || (e.pool == nullptr && empty == nullptr)) empty = &e;
+        }
+        if (empty != nullptr) {
+            empty->pool = pool;
+            empty->serial = pool->_serial;
+            empty->blocks.clear();
+        }
+        return empty;
+    }
+
+    // The thread is leaving, hand the blocks back to pools that still exist.
+    ~JCPoolThreadCache() {
+        std::lock_guard<std::mutex> registry(poolRegistryMutex());
+        for (auto &e : entries) {
+            if (e.pool == nullptr) continue;
+            auto &pools = poolRegistry();
+            if (std::find(pools.begin(), pools.end(), e.pool) == pools.end() || e.pool->_serial != e.serial)
+                continue;
+            std::lock_guard<std::mutex> lock(e.pool->mtx);
+            for (void *p : e.blocks) e.pool->_push(p);
+        }
+    }
+};
+
+static thread_local JCPoolThreadCache poolThreadCache;
+
+JCBlockPool::JCBlockPool(const char *name, size_t block_size, size_t chunk_blocks, int thread_cache)
+    : name(name), chunk_blocks(std::max<size_t>(chunk_blocks, 1)), thread_cache(thread_cache), _free(nullptr) {
+    // Every block holds the free list link and stays max_align_t aligned.
+    const size_t align = alignof(std::max_align_t);
+    this->block_size = (std::max(block_size, sizeof(void *)) + align - 1) / align * align;
+    _serial = poolSerial.fetch_add(1) + 1;
+    std::lock_guard<std::mutex> registry(poolRegistryMutex());
+    poolRegistry().push_back(this);
+}
+
+JCBlockPool::~JCBlockPool() {
+    {
+        std::lock_guard<std::mutex> registry(poolRegistryMutex());
+        auto &pools = poolRegistry();
+        pools.erase(std::find(pools.begin(), pools.end(), this));
+    }
+    for (void *chunk : _chunks) ::operator delete(chunk);
+}
+
+void* JCBlockPool::_pop() {
+    if (_free == nullptr) {
+        char *chunk = static_cast<char *>(::operator new(block_size * chunk_blocks));
+        _chunks.push_back(chunk);
+        stats.reserved.fetch_add(block_size * chunk_blocks, std::memory_order_relaxed);
+        // Thread the new blocks in address order.
+        for (size_t i = chunk_blocks; i-- > 0; ) _push(chunk + i * block_size);
+    }
+    void *p = _free;
+    _free = *static_cast<void **>(p);
+    return p;
+}
+
+void JCBlockPool::_push(void *p) {
+    *static_cast<void **>(p) = _free;
+    _free = p;
+}
+
+void* JCBlockPool::allocate() {
+    stats.allocs.fetch_add(1, std::memory_order_relaxed);
+    JCPoolThreadCache::entry *cache = thread_cache ? poolThreadCache.find(this) : nullptr;
+    if (cache == nullptr) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return _pop();
+    }
+    if (cache->blocks.empty()) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (int i = 0; i < JC_POOL_CACHE_BATCH; ++i) cache->blocks.push_back(_pop());
+    }
+    void *p = cache->blocks.back();
+    cache->blocks.pop_back();
+    return p;
+}
+
+void JCBlockPool::deallocate(void *p) {
+    if (p == nullptr) return;
+    stats.frees.fetch_add(1, std::memory_order_relaxed);
+    JCPoolThreadCache::entry *cache = thread_cache ? poolThreadCache.find(this) : nullptr;
+    if (cache == nullptr) {
+        std::lock_guard<std::mutex> lock(mtx);
+        _push(p);
+        return;
+    }
+    cache->blocks.push_back(p);
+    if (cache->blocks.size() < 2 * JC_POOL_CACHE_BATCH) return;
+    // Too many on this thread, e.g. it only frees what another one allocates.
+    std::lock_guard<std::mutex> lock(mtx);
+    for (int i = 0; i < JC_POOL_CACHE_BATCH; ++i) {
+        _push(cache->blocks.back());
+        cache->blocks.pop_back();
+    }
+}
+
+void JCPoolReport(std::ostream &out) {
+    struct total { uint64_t allocs = 0, frees = 0, live = 0, reserved = 0; };
+    std::map<std::string, total> totals;
+    {
+        std::lock_guard<std::mutex> registry(poolRegistryMutex());
+        for (JCBlockPool *pool : poolRegistry()) {
+            total &t = totals[pool->name];
+            uint64_t allocs = pool->stats.allocs.load(), frees = pool->stats.frees.load();
+            t.allocs += allocs;
+            t.frees += frees;
+            t.live += (allocs - frees) * pool->block_size;
+            t.reserved += pool->stats.reserved.load();
+        }
+    }
+    for (auto &[name, t] : totals)
+        out << "pool " << name << ": " << t.allocs << " allocs, " << t.frees << " frees, "
+            << t.live << " live bytes, " << t.reserved << " reserved bytes\n";
+}
+
+#endif // _JCENGINE_POOL_CPP_
@@ -0,0 +1,88 @@
+#ifndef _JCENGINE_SPRITE_CPP_
+#define _JCENGINE_SPRITE_CPP_
+
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+#include <jc_sprite.h>
+
+// Corners clockwise from the top-left, rotated around the center of dst.
+static void _quad(const JCSpriteBatch::_sprite &s, float tw, float th, SDL_Vertex *v) {
+    float u0 = 0, v0 = 0, u1 = 1, v1 = 1;
+    if (s.src.w > 0) {
+        u0 = s.src.x / tw, v0 = s.src.y / th;
+        u1 = (s.src.x + s.src.w) / tw, v1 = (s.src.y + s.src.h) / th;
+    }
+    float hw = s.dst.w / 2, hh = s.dst.h / 2;
+    float cx = s.dst.x + hw, cy = s.dst.y + hh;
+    float ox[4] = {-hw, hw, hw, -hw}, oy[4] = {-hh, -hh, hh, hh};
+    float us[4] = {u0, u1, u1, u0}, vs[4] = {v0, v0, v1, v1};
+    float c = 1, sn = 0;
+    if (s.angle != 0) {
+        float rad = s.angle * 3.14159265358979f / 180.0f;
+        c = std::cos(rad), sn = std::sin(rad);
+    }
+    for (int k = 0; k < 4; ++k) {
+        v[k].position = {cx + c * ox[k] - sn * oy[k], cy + sn * ox[k] + c * oy[k]};
+        v[k].color = s.color;
+        v[k].tex_coord = {us[k], vs[k]};
+    }
+}
+
+void JCSpriteBatch::draw(SDL_Texture *texture, const JCTransforms &transforms, int layer) {
+    size_t n = transforms.size();
+    _queue.reserve(_queue.size() + n);
+    for (size_t i = 0; i < n; ++i)
+        _queue.push_back({texture, layer, transforms.angle[i], transforms.world[i], {0, 0, 0, 0},
+            {1, 1, 1, 1}, (uint32_t)_queue.size()});
+}
+
+int JCSpriteBatch::flush() {
+    draw_calls = 0;
+    if (_queue.empty()) return JC_SUCCESS;
+    if (ren == nullptr) {
+        _queue.clear();
+        return JC_ERROR;
+    }
+
+    auto before = [](const _sprite &a, const _sprite &b) {
+        if (a.layer != b.layer) return a.layer < b.layer;
+        if (a.texture != b.texture) return std::less<SDL_Texture*>()(a.texture, b.texture);
+        return a.seq < b.seq;
+    };
+    // One texture on one layer, the common case, is already in order.
+    if (!std::is_sorted(_queue.begin(), _queue.end(), before))
+        std::sort(_queue.begin(), _queue.end(), before);
+
+    size_t n = _queue.size();
+    SDL_Vertex *vertices;
+    if (frame != nullptr) vertices = frame->makeArray<SDL_Vertex>(n * 4);
+    else {
+        _vertices.resize(n * 4);
+        vertices = _vertices.data();
+    }
+    for (int q = _indices.size() / 6; (size_t)q < n; ++q) {
+        int base = q * 4;
+        _indices.insert(_indices.end(), {base, base + 1, base + 2, base + 2, base + 3, base});
+    }
+
+    // Runs only break on a texture change: the sort already put the layers in order.
+    int ret = JC_SUCCESS;
+    for (size_t first = 0, last; first < n; first = last) {
+        SDL_Texture *texture = _queue[first].texture;
+        float tw = 1, th = 1;
+        if (texture != nullptr) SDL_GetTextureSize(texture, &tw, &th);
+        for (last = first; last < n && _queue[last].texture == texture; ++last)
+            _quad(_queue[last], tw, th, &vertices[last * 4]);
+        // Indices are relative to the vertex pointer, so every run reuses the same prefix.
+        if (!SDL_RenderGeometry(ren, texture, &vertices[first * 4], (int)(last - first) * 4,
+                _indices.data(), (int)(last - first) * 6))
+            ret = JC_ERROR;
+        draw_calls += 1;
+    }
+    _queue.clear();
+    return ret;
+}
+
+#endif // _JCENGINE_SPRITE_CPP_
@@ -0,0 +1,209 @@
+#ifndef _JCENGINE_TRANSFORM_CPP_
+#define _JCENGINE_TRANSFORM_CPP_
+
+#include <cmath>
+#include <algorithm>
+
+#include <jc_transform.h>
+#include <jc_math.h>
+
+slot_id JCTransforms::create(JCRect rect) {
+    slot_id id = _index.insert();
+    if (id == JC_SLOT_INVALID) return id;
+    x.push_back(rect.x), y.push_back(rect.y);
+    vx.push_back(0), vy.push_back(0);
+    angle.push_back(0), spin.push_back(0);
+    sx.push_back(1), sy.push_back(1);
+    w.push_back(rect.w), h.push_back(rect.h);
+    world.push_back(rect);
+    return id;
+}
+
+int JCTransforms::erase(slot_id id) {
+    uint32_t dense = _index.erase(id);
+    if (dense == UINT32_MAX) return JC_ERROR;
+    for (auto *v : {&x, &y, &vx, &vy, &angle, &spin, &sx, &sy, &w, &h}) {
+        (*v)[dense] = v->back();
+        v->pop_back();
+    }
+    world[dense] = world.back();
+    world.pop_back();
+    return JC_SUCCESS;
+}
+
+const JCRect* JCTransforms::rect(slot_id id) const {
+    uint32_t dense = index(id);
+    return dense == UINT32_MAX ? nullptr : &world[dense];
+}
+
+void JCTransforms::updateAll(float dt) {
+    size_t n = x.size();
+    float *px = x.data(), *py = y.data(), *pa = angle.data();
+    const float *pvx = vx.data(), *pvy = vy.data(), *pspin = spin.data();
+    for (size_t i = 0; i < n; ++i) {
+        px[i] += pvx[i] * dt;
+        py[i] += pvy[i] * dt;
+        pa[i] += pspin[i] * dt;
+    }
+
+    world.resize(n);
+    const float *pw = w.data(), *ph = h.data(), *psx = sx.data(), *psy = sy.data();
+    JCRect *out = world.data();
+    size_t i = 0;
+    #ifdef JC_SIMD_SSE
+    // Four objects per step: one register per component, transposed into four rects.
+    for (; i + 4 <= n; i += 4) {
+        __m128 rx = _mm_loadu_ps(px + i), ry = _mm_loadu_ps(py + i);
+        __m128 rw = _mm_mul_ps(_mm_loadu_ps(pw + i), _mm_loadu_ps(psx + i));
+        __m128 rh = _mm_mul_ps(_mm_loadu_ps(ph + i), _mm_loadu_ps(psy + i));
+        _MM_TRANSPOSE4_PS(rx, ry, rw, rh);
+        _mm_storeu_ps(&out[i].x, rx);
+        _mm_storeu_ps(&out[i + 1].x, ry);
+        _mm_storeu_ps(&out[i + 2].x, rw);
+        _mm_storeu_ps(&out[i + 3].x, rh);
+    }
+    #endif
+    for (; i < n; ++i) out[i] = {px[i], py[i], pw[i] * psx[i], ph[i] * psy[i]};
+}
+
+slot_id JCTransformTree::create(JCRect rect, slot_id parent_id) {
+    uint32_t p = UINT32_MAX;
+    if (parent_id != JC_SLOT_INVALID && (p = index(parent_id)) == UINT32_MAX) return JC_SLOT_INVALID;
+    slot_id id = _index.insert();
+    if (id == JC_SLOT_INVALID) return id;
+    uint32_t dense = x.size();
+    x.push_back(rect.x), y.push_back(rect.y);
+    angle.push_back(0), sx.push_back(1), sy.push_back(1);
+    w.push_back(rect.w), h.push_back(rect.h);
+    parent.push_back(parent_id);
+    wx.push_back(0), wy.push_back(0), wangle.push_back(0), wsx.push_back(1), wsy.push_back(1);
+    _wcos.push_back(1), _wsin.push_back(0);
+    world.push_back(rect);
+    dirty.push_back(1);
+    // The parent is already in _order, so appending keeps it parents first.
+    _order.push_back(dense);
+    _parent_index.push_back(p);
+    return id;
+}
+
+int JCTransformTree::erase(slot_id id) {
+    uint32_t target = index(id);
+    if (target == UINT32_MAX) return JC_ERROR;
+    if (_order_dirty) _rebuild_order();
+
+    // Parents come first in _order, so one pass marks the whole subtree.
+    std::vector<uint8_t> removed(x.size(), 0);
+    std::vector<uint32_t> doomed;
+    for (uint32_t i : _order) {
+        uint32_t p = _parent_index[i];
+        if (i == target || (p != UINT32_MAX && removed[p])) {
+            removed[i] = 1;
+            doomed.push_back(i);
+        }
+    }
+
+    // From the highest index down, the last element is never a doomed one.
+    std::sort(doomed.begin(), doomed.end(), std::greater<uint32_t>());
+    for (uint32_t dense : doomed) {
+        _index.erase(_index.handle(dense));
+        for (auto *v : {&x, &y, &angle, &sx, &sy, &w, &h, &wx, &wy, &wangle, &wsx, &wsy, &_wcos, &_wsin}) {
+            (*v)[dense] = v->back();
+            v->pop_back();
+        }
+        parent[dense] = parent.back(), parent.pop_back();
+        world[dense] = world.back(), world.pop_back();
+        dirty[dense] = dirty.back(), dirty.pop_back();
+    }
+    _order_dirty = 1;
+    return JC_SUCCESS;
+}
+
+int JCTransformTree::setLocal(slot_id id, float lx, float ly, float la, float lsx, float lsy) {
+    uint32_t i = index(id);
+    if (i == UINT32_MAX) return JC_ERROR;
+    x[i] = lx, y[i] = ly, angle[i] = la, sx[i] = lsx, sy[i] = lsy;
+    dirty[i] = 1;
+    return JC_SUCCESS;
+}
+
+int JCTransformTree::setSize(slot_id id, float lw, float lh) {
+    uint32_t i = index(id);
+    if (i == UINT32_MAX) return JC_ERROR;
+    w[i] = lw, h[i] = lh;
+    dirty[i] = 1;
+    return JC_SUCCESS;
+}
+
+int JCTransformTree::setParent(slot_id id, slot_id parent_id) {
+    uint32_t i = index(id);
+    if (i == UINT32_MAX) return JC_ERROR;
+    // Refuse to hang a node below itself.
+    for (slot_id p = parent_id; p != JC_SLOT_INVALID; ) {
+        uint32_t pi = index(p);
+        if (pi == UINT32_MAX || p == id) return JC_ERROR;
+        p = parent[pi];
+    }
+    parent[i] = parent_id;
+    dirty[i] = 1;
+    _order_dirty = 1;
+    return JC_SUCCESS;
+}
+
+const JCRect* JCTransformTree::rect(slot_id id) const {
+    uint32_t dense = index(id);
+    return dense == UINT32_MAX ? nullptr : &world[dense];
+}
+
+// Counting sort by depth, depths found by walking up until a known one.
+void JCTransformTree::_rebuild_order() {
+    size_t n = x.size();
+    _parent_index.resize(n);
+    for (size_t i = 0; i < n; ++i)
+        _parent_index[i] = parent[i] == JC_SLOT_INVALID ? UINT32_MAX : index(parent[i]);
+
+    std::vector<uint32_t> depth(n, UINT32_MAX), path;
+    uint32_t max_depth = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t at = i;
+        while (depth[at] == UINT32_MAX && _parent_index[at] != UINT32_MAX) {
+            path.push_back(at);
+            at = _parent_index[at];
+        }
+        if (depth[at] == UINT32_MAX) depth[at] = 0;
+        for (uint32_t d = depth[at]; !path.empty(); path.pop_back()) depth[path.back()] = ++d;
+        max_depth = std::max(max_depth, depth[i]);
+    }
+
+    std::vector<uint32_t> start(max_depth + 2, 0);
+    for (uint32_t d : depth) start[d + 1] += 1;
+    for (size_t d = 1; d < start.size(); ++d) start[d] += start[d - 1];
+    _order.resize(n);
+    for (uint32_t i = 0; i < n; ++i) _order[start[depth[i]]++] = i;
+    _order_dirty = 0;
+}
+
+void JCTransformTree::updateAll() {
+    if (_order_dirty) _rebuild_order();
+    const float to_rad = 3.14159265358979f / 180.0f;
+    for (uint32_t i : _order) {
+        uint32_t p = _parent_index[i];
+        if (p != UINT32_MAX && dirty[p]) dirty[i] = 1;
+        if (!dirty[i]) continue;
+        if (p == UINT32_MAX) {
+            wx[i] = x[i], wy[i] = y[i], wangle[i] = angle[i];
+            wsx[i] = sx[i], wsy[i] = sy[i];
+        } else {
+            float lx = x[i] * wsx[p], ly = y[i] * wsy[p];
+            wx[i] = wx[p] + _wcos[p] * lx - _wsin[p] * ly;
+            wy[i] = wy[p] + _wsin[p] * lx + _wcos[p] * ly;
+            wangle[i] = wangle[p] + angle[i];
+            wsx[i] = wsx[p] * sx[i], wsy[i] = wsy[p] * sy[i];
+        }
+        _wcos[i] = std::cos(wangle[i] * to_rad);
+        _wsin[i] = std::sin(wangle[i] * to_rad);
+        world[i] = {wx[i], wy[i], w[i] * wsx[i], h[i] * wsy[i]};
+    }
+    std::fill(dirty.begin(), dirty.end(), 0);
+}
+
+#endif // _JCENGINE_TRANSFORM_CPP_
@@ -0,0 +1,90 @@
+#ifndef _JCENGINE_WORKER_CPP_
+#define _JCENGINE_WORKER_CPP_
+
+#include <algorithm>
+
+#include <jc_worker.h>
+
+JCWorkerPool::JCWorkerPool(int threads) : running_(false), _queued(0), _next_worker(0) {
+    if (threads <= 0) threads = std::max<int>(std::thread::hardware_concurrency(), 1) - 1;
+    _thread_count = threads;
+}
+
+JCWorkerPool::~JCWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(_sleep_mtx);
+        running_ = false;
+    }
+    _sleep_cv.notify_all();
+    for (auto &thread : _threads) thread.join();
+}
+
+void JCWorkerPool::_start() {
+    running_ = true;
+    for (int i = 0; i < _thread_count; ++i) _workers.emplace_back(new _worker());
+    for (int i = 0; i < _thread_count; ++i)
+        _threads.emplace_back([this, i]() { _worker_loop(i); });
+}
+
+void JCWorkerPool::_run(size_t n, void (*fn)(void *, size_t), void *ctx) {
+    if (n == 0) return;
+    if (_thread_count == 0 || n == 1) {
+        for (size_t i = 0; i < n; ++i) fn(ctx, i);
+        return;
+    }
+    std::call_once(_started, [this]() { _start(); });
+
+    // Spread round-robin, idle workers even it out by stealing. Counted
+    // before pushing, so a thief never takes _queued below zero.
+    std::atomic<size_t> remaining(n);
+    _queued.fetch_add(n);
+    size_t first = _next_worker.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < n; ++i) {
+        _worker &w = *_workers[(first + i) % _workers.size()];
+        std::lock_guard<std::mutex> lock(w.mtx);
+        w.tasks.push_back({fn, ctx, i, &remaining});
+    }
+    {
+        std::lock_guard<std::mutex> lock(_sleep_mtx);
+    }
+    _sleep_cv.notify_all();
+
+    while (remaining.load(std::memory_order_acquire) != 0)
+        if (!_try_run(-1)) std::this_thread::yield();
+}
+
+bool JCWorkerPool::_try_run(int self) {
+    JCWorkerTask task;
+    bool found = false;
+    int count = _workers.size();
+    for (int k = 0; k < count && !found; ++k) {
+        int victim = self < 0 ? k : (self + k) % count;
+        _worker &w = *_workers[victim];
+        std::lock_guard<std::mutex> lock(w.mtx);
+        if (w.tasks.empty()) continue;
+        if (victim == self) {
+            task = w.tasks.back();
+            w.tasks.pop_back();
+        } else {
+            task = w.tasks.front();
+            w.tasks.pop_front();
+        }
+        found = true;
+    }
+    if (!found) return false;
+
+    _queued.fetch_sub(1);
+    task.fn(task.ctx, task.index);
+    task.remaining->fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void JCWorkerPool::_worker_loop(int self) {
+    while (running_) {
+        if (_try_run(self)) continue;
+        std::unique_lock<std::mutex> lock(_sleep_mtx);
+        _sleep_cv.wait(lock, [this]() { return _queued.load() != 0 || !running_; });
+    }
+}
+
+#endif // _JCENGINE_WORKER_CPP_